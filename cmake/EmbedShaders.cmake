@@ -0,0 +1,46 @@
+# Generates a C++ source that embeds every file of a directory as constexpr
+# character data, plus a registry to look them up by file name.
+#
+# Usage: cmake -DSHADER_DIR=<dir> -DOUTPUT=<file.cpp> -P EmbedShaders.cmake
+
+file(GLOB SHADER_FILES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*)
+list(SORT SHADER_FILES)
+
+# CMake regexes have no {n} repetition, so spell out sixteen bytes per line
+set(LINE_PATTERN "")
+foreach(I RANGE 15)
+    string(APPEND LINE_PATTERN "0x[0-9a-f][0-9a-f],")
+endforeach()
+
+set(DATA "")
+set(REGISTRY "")
+foreach(NAME ${SHADER_FILES})
+    if(IS_DIRECTORY ${SHADER_DIR}/${NAME})
+        continue()
+    endif()
+
+    file(READ ${SHADER_DIR}/${NAME} HEX HEX)
+    file(SIZE ${SHADER_DIR}/${NAME} SIZE)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+    string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n    " BYTES "${BYTES}")
+    string(MAKE_C_IDENTIFIER "shader_${NAME}" SYMBOL)
+
+    string(APPEND DATA "constexpr char ${SYMBOL}[] = {\n    ${BYTES}0x00\n};\n\n")
+    string(APPEND REGISTRY "    { \"${NAME}\", ${SYMBOL}, ${SIZE} },\n")
+endforeach()
+
+set(SOURCE "// Generated by cmake/EmbedShaders.cmake from ${SHADER_DIR}. Do not edit.\n")
+string(APPEND SOURCE "#include \"EmbeddedShaders.h\"\n\nnamespace {\n\n")
+string(APPEND SOURCE "${DATA}")
+string(APPEND SOURCE "constexpr EmbeddedShader registry[] = {\n${REGISTRY}};\n\n}\n\n")
+string(APPEND SOURCE "const EmbeddedShader* findEmbeddedShader(const std::string& name) {\n")
+string(APPEND SOURCE "    for (const EmbeddedShader& shader : registry) {\n")
+string(APPEND SOURCE "        if (name == shader.name)\n")
+string(APPEND SOURCE "            return &shader;\n")
+string(APPEND SOURCE "    }\n")
+string(APPEND SOURCE "    return nullptr;\n}\n")
+
+# Only touch the output when it changes so dependents are not rebuilt needlessly
+file(WRITE ${OUTPUT}.tmp "${SOURCE}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
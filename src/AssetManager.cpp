@@ -0,0 +1,280 @@
+#include "AssetManager.h"
+#include "AssetPack.h"
+#include "Profiler.h"
+#include "SpriteRenderer.h"
+#include "TextureAtlas.h"
+#include "TextureFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+double now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+AssetManager::AssetManager(TextureAtlas& atlas, const std::string& directory,
+                           unsigned int workerCount, size_t uploadBudget)
+    : atlases(1, &atlas), atlasFormats(1u << atlas.format()), directory(directory),
+      uploadBudget(uploadBudget), uploader(4, uploadBudget) {
+    if (workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    for (unsigned int i = 0; i < workerCount; ++i)
+        workers.emplace_back(&AssetManager::workerLoop, this);
+}
+
+AssetManager::~AssetManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void AssetManager::addAtlas(TextureAtlas& atlas) {
+    atlases.push_back(&atlas);
+    atlasFormats |= 1u << atlas.format();
+}
+
+AssetHandle AssetManager::loadImage(const std::string& name, int priority) {
+    uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slots.emplace_back();
+        index = static_cast<uint32_t>(slots.size() - 1);
+    }
+    Slot& slot = slots[index];
+    slot.state = AssetState::Queued;
+    slot.atlas = nullptr;
+    slot.atlasHandle = 0;
+    slot.requested = now();
+    slot.latency = 0.0;
+
+    AssetHandle handle;
+    handle.index = index + 1;
+    handle.generation = slot.generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push({ priority, nextSequence++, index, slot.generation, name });
+    }
+    wake.notify_one();
+    return handle;
+}
+
+void AssetManager::release(AssetHandle handle) {
+    if (!find(handle))
+        return;
+    Slot& slot = slots[handle.index - 1];
+    if (slot.atlasHandle)
+        slot.atlas->evict(slot.atlasHandle);
+    // A load still in flight is dropped when its generation no longer matches
+    slot = Slot{ slot.generation + 1 };
+    freeSlots.push_back(handle.index - 1);
+}
+
+void AssetManager::update() {
+    PROFILE_SCOPE("Asset update");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::move(results.begin(), results.end(), std::back_inserter(uploads));
+        results.clear();
+        counters.queueDepth = static_cast<unsigned int>(requests.size());
+    }
+
+    size_t submitted = 0;
+    while (!uploads.empty()) {
+        Result& result = uploads.front();
+        Slot& slot = slots[result.index];
+        if (slot.generation != result.generation) {
+            uploads.pop_front(); // Released while loading
+            continue;
+        }
+        if (!result.ok) {
+            finish(slot, AssetState::Failed);
+            uploads.pop_front();
+            continue;
+        }
+
+        // Always submit at least one image, however large, so nothing starves
+        size_t bytes = TextureFormat::imageSize(result.format, result.width, result.height);
+        if (submitted > 0 && submitted + bytes > uploadBudget)
+            break;
+
+        TextureAtlas* atlas = atlasFor(result.format);
+        uint32_t atlasHandle = atlas ? atlas->allocate(result.width, result.height) : 0;
+        if (!atlasHandle) {
+            std::cerr << "ERROR::ASSET_MANAGER::ATLAS_FULL" << std::endl;
+            finish(slot, AssetState::Failed);
+            uploads.pop_front();
+            continue;
+        }
+        slot.atlas = atlas;
+        slot.atlasHandle = atlasHandle;
+        slot.state = AssetState::Uploading;
+
+        // A worker copies into the staging buffer; the upload then reads from it
+        const void* pixels = result.pixels;
+        std::shared_ptr<Image> image = result.image;
+        uint32_t index = result.index, generation = result.generation;
+        uploader.submit(bytes,
+            [pixels, image, bytes](void* destination) { std::memcpy(destination, pixels, bytes); },
+            [this, index, generation, atlas, atlasHandle](const void* offset) {
+                // A release meanwhile already gave the atlas space back
+                if (!isCurrent(index, generation))
+                    return;
+                atlas->upload(atlasHandle, offset);
+                if (TextureFormat::isCompressed(atlas->format()))
+                    counters.compressed++;
+                finish(slots[index], AssetState::Ready);
+            },
+            [this, index, generation]() {
+                // The staging buffer was lost; give the atlas space back
+                if (!isCurrent(index, generation))
+                    return;
+                Slot& lost = slots[index];
+                lost.atlas->evict(lost.atlasHandle);
+                lost.atlas = nullptr;
+                lost.atlasHandle = 0;
+                finish(lost, AssetState::Failed);
+            });
+        submitted += bytes;
+        uploads.pop_front();
+    }
+    uploader.update();
+
+    counters.bytesUploaded = submitted;
+    counters.pendingUploads = static_cast<unsigned int>(uploads.size() + uploader.pending());
+}
+
+void AssetManager::finish(Slot& slot, AssetState state) {
+    slot.state = state;
+    if (state == AssetState::Failed) {
+        counters.failed++;
+        return;
+    }
+    slot.latency = now() - slot.requested;
+    counters.loaded++;
+    totalLatency += slot.latency;
+    counters.averageLatency = totalLatency / counters.loaded;
+    counters.maxLatency = std::max(counters.maxLatency, slot.latency);
+}
+
+AssetState AssetManager::state(AssetHandle handle) const {
+    const Slot* slot = find(handle);
+    if (!slot)
+        return AssetState::Invalid;
+    if (slot->state != AssetState::Queued)
+        return slot->state;
+    // Decoded but not uploaded yet
+    for (const Result& result : uploads) {
+        if (result.index == handle.index - 1 && result.generation == handle.generation)
+            return AssetState::Decoded;
+    }
+    return AssetState::Queued;
+}
+
+bool AssetManager::apply(AssetHandle handle, Sprite& sprite) const {
+    const Slot* slot = find(handle);
+    if (!slot || slot->state != AssetState::Ready)
+        return false;
+    slot->atlas->apply(slot->atlasHandle, sprite);
+    return true;
+}
+
+double AssetManager::latency(AssetHandle handle) const {
+    const Slot* slot = find(handle);
+    return slot ? slot->latency : 0.0;
+}
+
+bool AssetManager::isCurrent(uint32_t index, uint32_t generation) const {
+    return index < slots.size() && slots[index].generation == generation;
+}
+
+TextureAtlas* AssetManager::atlasFor(uint32_t format) const {
+    for (TextureAtlas* atlas : atlases) {
+        if (atlas->format() == format)
+            return atlas;
+    }
+    return nullptr;
+}
+
+const AssetManager::Slot* AssetManager::find(AssetHandle handle) const {
+    if (handle.index == 0 || handle.index > slots.size())
+        return nullptr;
+    const Slot& slot = slots[handle.index - 1];
+    return slot.generation == handle.generation && slot.state != AssetState::Invalid ? &slot : nullptr;
+}
+
+void AssetManager::workerLoop() {
+    Profiler::instance().setThreadName("Asset worker");
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+            request = requests.top();
+            requests.pop();
+        }
+
+        Result result;
+        result.index = request.index;
+        result.generation = request.generation;
+        result.ok = load(request.name, result);
+        if (!result.ok)
+            std::cerr << "ERROR::ASSET_MANAGER::LOAD_FAILED\n" << request.name << std::endl;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+    }
+}
+
+// Runs on a worker: cooked images come straight from the mapped pack
+// (decoded first if no atlas takes their format), anything else is read
+// from disk and decoded
+bool AssetManager::load(const std::string& name, Result& result) const {
+    PROFILE_SCOPE("Load image");
+    AssetView view;
+    if (AssetPack::instance().find(name, view) && view.type == AssetPackFormat::ASSET_IMAGE) {
+        result.width = static_cast<int>(view.width);
+        result.height = static_cast<int>(view.height);
+        if (view.size < TextureFormat::imageSize(view.format, result.width, result.height))
+            return false;
+        if (view.format < 32 && (atlasFormats & (1u << view.format))) {
+            result.format = view.format;
+            result.pixels = view.data;
+            return true;
+        }
+        result.image = std::make_shared<Image>();
+        if (!TextureFormat::decode(view.format, view.data, result.width, result.height, *result.image))
+            return false;
+        result.pixels = result.image->pixels.data();
+        return true;
+    }
+
+    std::ifstream file(directory + "/" + name, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    result.image = std::make_shared<Image>();
+    if (!decodePPM(data.data(), data.size(), *result.image))
+        return false;
+    result.width = result.image->width;
+    result.height = result.image->height;
+    result.pixels = result.image->pixels.data();
+    return true;
+}
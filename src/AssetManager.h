@@ -0,0 +1,151 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AssetPackFormat.h"
+#include "Image.h"
+#include "TextureUploader.h"
+
+class TextureAtlas;
+struct Sprite;
+
+// Reference to a loaded (or loading) asset. A released slot bumps its
+// generation, so stale handles are detected instead of aliasing a new asset.
+struct AssetHandle {
+    uint32_t index = 0; // Slot + 1, 0 = null handle
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return index != 0; }
+};
+
+enum class AssetState {
+    Invalid,   // Null, stale or released handle
+    Queued,    // Waiting for a worker
+    Decoded,   // Read and decoded, waiting for upload budget
+    Uploading, // Being copied into a staging buffer
+    Ready,
+    Failed
+};
+
+struct AssetManagerStats {
+    unsigned int queueDepth = 0;      // Requests not picked up by a worker yet
+    unsigned int pendingUploads = 0;  // Decoded images waiting for upload budget
+    unsigned int loaded = 0;          // Since startup
+    unsigned int failed = 0;
+    unsigned int compressed = 0;      // Loaded in a block-compressed format
+    size_t bytesUploaded = 0;         // Submitted for upload by the last update()
+    double averageLatency = 0.0;      // Seconds from request to ready
+    double maxLatency = 0.0;
+};
+
+// Streams images into a TextureAtlas in the background. Worker threads read
+// (from the AssetPack, else PPM files under a directory) and decode in
+// priority order; update() hands at most uploadBudget bytes per frame to a
+// TextureUploader, whose workers copy them into pixel buffer objects, so
+// loading never causes a frame spike. Block-compressed images from the pack
+// go to an atlas of their format when one was added, else they are decoded
+// to RGBA8 on the worker.
+class AssetManager {
+public:
+    // workerCount 0 picks one less than the hardware threads
+    AssetManager(TextureAtlas& atlas, const std::string& directory,
+                 unsigned int workerCount = 0, size_t uploadBudget = 4 * 1024 * 1024);
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Upload images cooked in atlas.format() into this atlas as they are.
+    // Call before loading anything; the format must be supported.
+    void addAtlas(TextureAtlas& atlas);
+
+    // Queue an image; higher priority loads first, equal priorities in order
+    AssetHandle loadImage(const std::string& name, int priority = 0);
+
+    // Drop an asset (and its atlas space); the handle becomes invalid
+    void release(AssetHandle handle);
+
+    // Upload finished images within the budget. Call once per frame on the GL thread.
+    void update();
+
+    AssetState state(AssetHandle handle) const;
+
+    // Point a sprite at a ready image; false if it is not ready
+    bool apply(AssetHandle handle, Sprite& sprite) const;
+
+    // Seconds from request to ready, 0 until the asset is ready
+    double latency(AssetHandle handle) const;
+
+    const AssetManagerStats& stats() const { return counters; }
+
+private:
+    struct Slot {
+        uint32_t generation = 1;
+        AssetState state = AssetState::Invalid;
+        TextureAtlas* atlas = nullptr;
+        uint32_t atlasHandle = 0;
+        double requested = 0.0;
+        double latency = 0.0;
+    };
+
+    struct Request {
+        int priority;
+        uint64_t sequence;
+        uint32_t index, generation;
+        std::string name;
+
+        // priority_queue pops the largest: highest priority, then oldest
+        bool operator<(const Request& other) const {
+            return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+        }
+    };
+
+    struct Result {
+        uint32_t index, generation;
+        bool ok = false;
+        int width = 0, height = 0;
+        uint32_t format = AssetPackFormat::FORMAT_RGBA8;
+        const void* pixels = nullptr; // Into the asset pack, or image->pixels
+        std::shared_ptr<Image> image; // Shared with the upload that copies it
+    };
+
+    void workerLoop();
+    bool load(const std::string& name, Result& result) const;
+    TextureAtlas* atlasFor(uint32_t format) const;
+    const Slot* find(AssetHandle handle) const;
+    bool isCurrent(uint32_t index, uint32_t generation) const;
+    void finish(Slot& slot, AssetState state);
+
+    std::vector<TextureAtlas*> atlases; // RGBA8 atlas first
+    std::atomic<uint32_t> atlasFormats; // Bit per ImageFormat with an atlas, read by workers
+    std::string directory;
+    size_t uploadBudget;
+    TextureUploader uploader;
+
+    std::vector<Slot> slots; // GL thread only
+    std::vector<uint32_t> freeSlots;
+    std::deque<Result> uploads;
+    uint64_t nextSequence = 0;
+    double totalLatency = 0.0;
+
+    std::mutex mutex; // Guards requests, results and stopping
+    std::condition_variable wake;
+    std::priority_queue<Request> requests;
+    std::deque<Result> results;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    AssetManagerStats counters;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "AssetPack.h"
+#include "Hash.h"
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace AssetPackFormat;
+
+AssetPack& AssetPack::instance() {
+    static AssetPack pack;
+    return pack;
+}
+
+AssetPack::~AssetPack() {
+    close();
+}
+
+bool AssetPack::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    HANDLE mappingHandle = nullptr;
+    if (GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        std::cerr << "ERROR::ASSET_PACK::CANNOT_MAP\n" << path << std::endl;
+        return false;
+    }
+    file = fileHandle;
+    mapping = mappingHandle;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    base = static_cast<const unsigned char*>(view);
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        std::cerr << "ERROR::ASSET_PACK::CANNOT_MAP\n" << path << std::endl;
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    base = static_cast<const unsigned char*>(view);
+#endif
+
+    // Check everything the lookups rely on once, so they need no bounds checks
+    header = reinterpret_cast<const Header*>(base);
+    bool valid = length >= sizeof(Header)
+        && std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+        && header->version == VERSION
+        && header->tocOffset <= length
+        && header->entryCount <= (length - header->tocOffset) / sizeof(TocEntry)
+        && header->namesOffset <= length;
+    if (valid) {
+        toc = reinterpret_cast<const TocEntry*>(base + header->tocOffset);
+        names = reinterpret_cast<const char*>(base + header->namesOffset);
+        namesLength = length - header->namesOffset;
+        for (uint32_t i = 0; valid && i < header->entryCount; ++i) {
+            const TocEntry& entry = toc[i];
+            valid = entry.offset <= length && entry.size <= length - entry.offset
+                 && entry.nameOffset < namesLength
+                 && std::memchr(names + entry.nameOffset, '\0', namesLength - entry.nameOffset) != nullptr;
+        }
+    }
+    if (!valid) {
+        std::cerr << "ERROR::ASSET_PACK::INVALID_PACK\n" << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AssetPack::close() {
+#ifdef _WIN32
+    if (base)
+        UnmapViewOfFile(base);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    file = mapping = nullptr;
+#else
+    if (base)
+        munmap(const_cast<unsigned char*>(base), length);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    base = nullptr;
+    length = 0;
+    header = nullptr;
+    toc = nullptr;
+    names = nullptr;
+    namesLength = 0;
+}
+
+bool AssetPack::find(const std::string& name, AssetView& view) const {
+    if (!header)
+        return false;
+
+    uint64_t hash = fnv1a64(name.data(), name.size());
+    const TocEntry* first = toc;
+    const TocEntry* last = toc + header->entryCount;
+    while (first < last) {
+        const TocEntry* middle = first + (last - first) / 2;
+        if (middle->nameHash < hash)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    // The cooker rejects hash collisions, the name check guards against lookups of unknown names
+    if (first == toc + header->entryCount || first->nameHash != hash || name != names + first->nameOffset)
+        return false;
+    makeView(*first, view);
+    return true;
+}
+
+std::vector<std::string> AssetPack::list(uint32_t type) const {
+    std::vector<std::string> result;
+    for (uint32_t i = 0; i < count(); ++i) {
+        if (toc[i].type == type)
+            result.push_back(names + toc[i].nameOffset);
+    }
+    return result;
+}
+
+bool AssetPack::verify(const AssetView& view) {
+    return fnv1a64(view.data, view.size) == view.contentHash;
+}
+
+void AssetPack::makeView(const TocEntry& entry, AssetView& view) const {
+    view.data = base + entry.offset;
+    view.size = static_cast<size_t>(entry.size);
+    view.type = entry.type;
+    view.width = entry.width;
+    view.height = entry.height;
+    view.format = entry.format;
+    view.contentHash = entry.contentHash;
+}
@@ -0,0 +1,69 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AssetPackFormat.h"
+
+// An asset inside the mapped pack. data points straight into the mapping
+// and stays valid until the pack is closed.
+struct AssetView {
+    const void* data = nullptr;
+    size_t size = 0;
+    uint32_t type = AssetPackFormat::ASSET_RAW;
+    uint32_t width = 0, height = 0; // Images only
+    uint32_t format = AssetPackFormat::FORMAT_RGBA8;
+    uint64_t contentHash = 0;
+};
+
+// Read-only view of a pack written by tools/asset_cooker. The file is
+// memory mapped, so opening it costs a header check and assets are read
+// without copying.
+class AssetPack {
+public:
+    // The pack shared by every loader
+    static AssetPack& instance();
+
+    ~AssetPack();
+
+    // Map a pack file, replacing any open one. Returns false (and leaves
+    // no pack open) if the file is missing or malformed.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // Look an asset up by the name it was cooked under
+    bool find(const std::string& name, AssetView& view) const;
+
+    // Names of every asset of one type, in table order
+    std::vector<std::string> list(uint32_t type) const;
+
+    // Recompute an asset's content hash, false if the data is corrupt
+    static bool verify(const AssetView& view);
+
+    uint32_t count() const { return header ? header->entryCount : 0; }
+
+private:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    void makeView(const AssetPackFormat::TocEntry& entry, AssetView& view) const;
+
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+    const AssetPackFormat::Header* header = nullptr;
+    const AssetPackFormat::TocEntry* toc = nullptr;
+    const char* names = nullptr;
+    size_t namesLength = 0;
+#ifdef _WIN32
+    void* file = nullptr;    // HANDLE
+    void* mapping = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ASSET_PACK_FORMAT_H
+#define ASSET_PACK_FORMAT_H
+
+#include <cstdint>
+
+// Binary layout of the asset pack, shared by tools/asset_cooker and the
+// runtime AssetPack. All fields are little endian.
+//
+//   Header | blobs, each at a multiple of ALIGNMENT | TocEntry[entryCount] | names
+//
+// The table of contents is sorted by nameHash so lookups are a binary
+// search, and blobs are stored ready to hand to GL: shader text as is,
+// images as RGBA8 rows bottom to top, or as 4x4 blocks of a compressed
+// format in the same order.
+namespace AssetPackFormat {
+
+const char MAGIC[4] = { 'G', 'E', 'P', 'K' };
+const uint32_t VERSION = 2;
+const uint64_t ALIGNMENT = 256;
+
+enum AssetType : uint32_t {
+    ASSET_RAW = 0,    // Level data and anything else, copied verbatim
+    ASSET_SHADER = 1, // GLSL source
+    ASSET_IMAGE = 2,  // width x height, in an ImageFormat
+};
+
+// Pixel format of an ASSET_IMAGE. Compressed images hold whole 4x4 blocks,
+// so their data covers the size rounded up to a multiple of 4.
+enum ImageFormat : uint32_t {
+    FORMAT_RGBA8 = 0,
+    FORMAT_BC1 = 1,        // S3TC DXT1, 1-bit alpha, 8 bytes per block
+    FORMAT_BC3 = 2,        // S3TC DXT5, 16 bytes per block
+    FORMAT_BC7 = 3,        // BPTC, 16 bytes per block
+    FORMAT_ETC2_RGBA8 = 4, // ETC2 + EAC alpha, 16 bytes per block
+};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+};
+
+struct TocEntry {
+    uint64_t nameHash;    // fnv1a64 of the name, the sort key
+    uint64_t offset;      // Blob position from the start of the file
+    uint64_t size;        // Blob bytes
+    uint64_t contentHash; // fnv1a64 of the blob
+    uint32_t nameOffset;  // Null-terminated name, from namesOffset
+    uint32_t type;        // AssetType
+    uint32_t width;       // Images only
+    uint32_t height;
+    uint32_t format;      // ImageFormat, images only
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 32, "Header layout changed");
+static_assert(sizeof(TocEntry) == 56, "TocEntry layout changed");
+
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace BlockCompression {
+
+namespace {
+
+int blocks(int pixels) {
+    return (pixels + 3) / 4;
+}
+
+uint16_t packRGB565(const int rgb[3]) {
+    return static_cast<uint16_t>(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5
+                                 | ((rgb[2] * 31 + 127) / 255));
+}
+
+void unpackRGB565(uint16_t color, int rgb[3]) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Copy a 4x4 block out of the image, clamping at the right and top edges
+void fetchBlock(const uint8_t* rgba, int width, int height, int bx, int by, uint8_t block[16][4]) {
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block[y * 4 + x], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+        }
+    }
+}
+
+// Palette of a color block: 4 colors, or 3 plus transparent black when c0 <= c1
+void colorPalette(uint16_t c0, uint16_t c1, bool allowTransparent, int palette[4][4]) {
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    if (c0 > c1 || !allowTransparent) {
+        for (int i = 0; i < 3; ++i) {
+            palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+            palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    } else {
+        for (int i = 0; i < 3; ++i) {
+            palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+            palette[3][i] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+}
+
+// Encode the colors of a block. With punchThrough, pixels under half alpha
+// map to the transparent entry of BC1's three-color mode.
+void encodeColorBlock(const uint8_t block[16][4], bool punchThrough, uint8_t* out) {
+    // Endpoints: the bounding box of the opaque colors, inset by 1/16 to
+    // reduce the error of the extremes
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+    bool transparent = false, anyOpaque = false;
+    for (int i = 0; i < 16; ++i) {
+        if (punchThrough && block[i][3] < 128) {
+            transparent = true;
+            continue;
+        }
+        anyOpaque = true;
+        for (int c = 0; c < 3; ++c) {
+            low[c] = std::min(low[c], static_cast<int>(block[i][c]));
+            high[c] = std::max(high[c], static_cast<int>(block[i][c]));
+        }
+    }
+    if (!anyOpaque) {
+        low[0] = low[1] = low[2] = high[0] = high[1] = high[2] = 0;
+    }
+    for (int c = 0; c < 3; ++c) {
+        int inset = (high[c] - low[c]) / 16;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+
+    uint16_t c0 = packRGB565(high), c1 = packRGB565(low);
+    // Four-color mode needs c0 > c1, the transparent mode c0 <= c1
+    if (transparent ? c0 > c1 : c0 < c1)
+        std::swap(c0, c1);
+    if (!transparent && c0 == c1) {
+        // Flat block: any index works, keep the four-color mode
+        if (c1 > 0) c1--; else c0++;
+    }
+
+    int palette[4][4];
+    colorPalette(c0, c1, true, palette);
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0;
+        if (transparent && block[i][3] < 128) {
+            best = 3;
+        } else {
+            int bestError = 1 << 30;
+            for (int p = 0; p < (transparent ? 3 : 4); ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = static_cast<int>(block[i][c]) - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+        }
+        indices |= static_cast<uint32_t>(best) << (i * 2);
+    }
+
+    out[0] = static_cast<uint8_t>(c0);
+    out[1] = static_cast<uint8_t>(c0 >> 8);
+    out[2] = static_cast<uint8_t>(c1);
+    out[3] = static_cast<uint8_t>(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+}
+
+void alphaPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i)
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (int i = 1; i < 5; ++i)
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void encodeAlphaBlock(const uint8_t block[16][4], uint8_t* out) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, static_cast<int>(block[i][3]));
+        a1 = std::min(a1, static_cast<int>(block[i][3]));
+    }
+    if (a0 == a1) {
+        // Uniform alpha; force the eight-value mode with a valid ordering
+        if (a1 > 0) a1--; else a0++;
+    }
+
+    int palette[8];
+    alphaPalette(a0, a1, palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < 8; ++p) {
+            int error = std::abs(static_cast<int>(block[i][3]) - palette[p]);
+            if (error < bestError) {
+                bestError = error;
+                best = p;
+            }
+        }
+        indices |= static_cast<uint64_t>(best) << (i * 3);
+    }
+
+    out[0] = static_cast<uint8_t>(a0);
+    out[1] = static_cast<uint8_t>(a1);
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+}
+
+void decodeColorBlock(const uint8_t* in, bool allowTransparent, uint8_t block[16][4]) {
+    uint16_t c0 = static_cast<uint16_t>(in[0] | in[1] << 8);
+    uint16_t c1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+    int palette[4][4];
+    colorPalette(c0, c1, allowTransparent, palette);
+    uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | static_cast<uint32_t>(in[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        const int* color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; ++c)
+            block[i][c] = static_cast<uint8_t>(color[c]);
+    }
+}
+
+void decodeAlphaBlock(const uint8_t* in, uint8_t block[16][4]) {
+    int palette[8];
+    alphaPalette(in[0], in[1], palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i)
+        indices |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+    for (int i = 0; i < 16; ++i)
+        block[i][3] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+}
+
+void storeBlock(const uint8_t block[16][4], int width, int height, int bx, int by, uint8_t* rgba) {
+    for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+        for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+            std::memcpy(&rgba[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], block[y * 4 + x], 4);
+    }
+}
+
+}
+
+size_t bc1Size(int width, int height) {
+    return static_cast<size_t>(blocks(width)) * blocks(height) * 8;
+}
+
+size_t bc3Size(int width, int height) {
+    return static_cast<size_t>(blocks(width)) * blocks(height) * 16;
+}
+
+void encodeBC1(const uint8_t* rgba, int width, int height, uint8_t* out) {
+    uint8_t block[16][4];
+    for (int by = 0; by < blocks(height); ++by) {
+        for (int bx = 0; bx < blocks(width); ++bx, out += 8) {
+            fetchBlock(rgba, width, height, bx, by, block);
+            encodeColorBlock(block, true, out);
+        }
+    }
+}
+
+void encodeBC3(const uint8_t* rgba, int width, int height, uint8_t* out) {
+    uint8_t block[16][4];
+    for (int by = 0; by < blocks(height); ++by) {
+        for (int bx = 0; bx < blocks(width); ++bx, out += 16) {
+            fetchBlock(rgba, width, height, bx, by, block);
+            encodeAlphaBlock(block, out);
+            encodeColorBlock(block, false, out + 8);
+        }
+    }
+}
+
+void decodeBC1(const uint8_t* in, int width, int height, uint8_t* rgba) {
+    uint8_t block[16][4];
+    for (int by = 0; by < blocks(height); ++by) {
+        for (int bx = 0; bx < blocks(width); ++bx, in += 8) {
+            decodeColorBlock(in, true, block);
+            storeBlock(block, width, height, bx, by, rgba);
+        }
+    }
+}
+
+void decodeBC3(const uint8_t* in, int width, int height, uint8_t* rgba) {
+    uint8_t block[16][4];
+    for (int by = 0; by < blocks(height); ++by) {
+        for (int bx = 0; bx < blocks(width); ++bx, in += 16) {
+            decodeColorBlock(in + 8, false, block);
+            decodeAlphaBlock(in, block);
+            storeBlock(block, width, height, bx, by, rgba);
+        }
+    }
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+// BC1 (DXT1) and BC3 (DXT5) block codecs for RGBA8 images. The encoders are
+// the fast "range fit" kind used by the asset cooker, the decoders are the
+// runtime fallback when the driver lacks S3TC. Images of any size are
+// handled; partial edge blocks repeat the last row/column.
+namespace BlockCompression {
+
+// Bytes of a compressed image of the given size (8 or 16 bytes per 4x4 block)
+size_t bc1Size(int width, int height);
+size_t bc3Size(int width, int height);
+
+// BC1 keeps 1-bit alpha: pixels with alpha < 128 become transparent
+void encodeBC1(const uint8_t* rgba, int width, int height, uint8_t* out);
+void encodeBC3(const uint8_t* rgba, int width, int height, uint8_t* out);
+
+void decodeBC1(const uint8_t* blocks, int width, int height, uint8_t* rgba);
+void decodeBC3(const uint8_t* blocks, int width, int height, uint8_t* rgba);
+
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <cstddef>
+#include <string>
+
+// Shader source compiled into the executable (GAMEENGINE_EMBED_SHADERS).
+// The registry is generated from shaders/ by cmake/EmbedShaders.cmake.
+struct EmbeddedShader {
+    const char* name; // File name inside shaders/, e.g. "vertex_shader.txt"
+    const char* data; // Null-terminated source
+    size_t size;      // Bytes, excluding the terminator
+};
+
+// The embedded file with that name, or nullptr
+const EmbeddedShader* findEmbeddedShader(const std::string& name);
+
+#endif
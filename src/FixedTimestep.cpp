@@ -0,0 +1,25 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double step, unsigned int maxSteps)
+    : stepTime(step), maxSteps(std::max(maxSteps, 1u)) {}
+
+unsigned int FixedTimestep::advance(double elapsed) {
+    accumulator += std::max(elapsed, 0.0);
+
+    unsigned int steps = 0;
+    while (accumulator >= stepTime && steps < maxSteps) {
+        accumulator -= stepTime;
+        steps++;
+    }
+    if (accumulator >= stepTime) {
+        // Keep the fraction so interpolation stays smooth, drop whole steps
+        double dropped = std::floor(accumulator / stepTime) * stepTime;
+        accumulator -= dropped;
+        counters.droppedTime += dropped;
+        counters.clampedFrames++;
+    }
+    counters.steps += steps;
+    return steps;
+}
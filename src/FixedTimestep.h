@@ -0,0 +1,42 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <cstdint>
+
+struct FixedTimestepStats {
+    uint64_t steps = 0;              // Since startup
+    unsigned int clampedFrames = 0;  // Frames that hit maxSteps and dropped time
+    double droppedTime = 0.0;        // Seconds of simulation skipped by the cap
+};
+
+// Accumulator for a fixed simulation step. Each frame advance() adds the
+// elapsed real time and returns how many whole steps to simulate; what is
+// left over is alpha() of a step, to interpolate rendered transforms
+// between the last two simulated states. Simulation cost stays the same
+// whatever the frame rate, and the same inputs produce the same steps.
+class FixedTimestep {
+public:
+    // step in seconds (1/120 for 120 Hz). When a slow frame would need more
+    // than maxSteps steps the rest is dropped, so a simulation that cannot
+    // keep up slows down instead of spiralling (each late frame queuing
+    // more steps, making the next one later still).
+    explicit FixedTimestep(double step = 1.0 / 120.0, unsigned int maxSteps = 8);
+
+    // Add elapsed seconds; returns the number of steps to run now
+    unsigned int advance(double elapsed);
+
+    // Fraction of a step accumulated past the last one, in [0, 1)
+    double alpha() const { return accumulator / stepTime; }
+
+    double step() const { return stepTime; }
+
+    const FixedTimestepStats& stats() const { return counters; }
+
+private:
+    double stepTime;
+    unsigned int maxSteps;
+    double accumulator = 0.0;
+    FixedTimestepStats counters;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "FrameTimings.h"
+#include <algorithm>
+
+namespace {
+
+// Percentile of sorted samples, rounded to the nearest sample
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+}
+
+FrameTimingSummary FrameTimings::summary() const {
+    FrameTimingSummary result;
+    if (samples.empty())
+        return result;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    result.frames = static_cast<unsigned int>(sorted.size());
+    for (double sample : sorted)
+        result.total += sample;
+    result.average = result.total / static_cast<double>(sorted.size());
+    result.minimum = sorted.front();
+    result.median = percentile(sorted, 0.5);
+    result.p95 = percentile(sorted, 0.95);
+    result.p99 = percentile(sorted, 0.99);
+    result.maximum = sorted.back();
+    return result;
+}
@@ -0,0 +1,33 @@
+#ifndef FRAME_TIMINGS_H
+#define FRAME_TIMINGS_H
+
+#include <vector>
+
+// Distribution of the recorded frame times, in seconds
+struct FrameTimingSummary {
+    unsigned int frames = 0;
+    double total = 0.0;
+    double average = 0.0;
+    double minimum = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double maximum = 0.0;
+};
+
+// Records every frame time of a run so benchmarks can report percentiles,
+// which show hitches an average hides.
+class FrameTimings {
+public:
+    void reserve(unsigned int frames) { samples.reserve(frames); }
+    void add(double seconds) { samples.push_back(seconds); }
+    void clear() { samples.clear(); }
+    unsigned int frames() const { return static_cast<unsigned int>(samples.size()); }
+
+    FrameTimingSummary summary() const;
+
+private:
+    std::vector<double> samples;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#include "GLExtensions.h"
+#include <unordered_set>
+#include <glad/glad.h>
+
+bool GLExtensions::has(const std::string& name) {
+    static const std::unordered_set<std::string> extensions = [] {
+        std::unordered_set<std::string> names;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+            if (extension)
+                names.insert(reinterpret_cast<const char*>(extension));
+        }
+        return names;
+    }();
+    return extensions.count(name) != 0;
+}
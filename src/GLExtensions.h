@@ -0,0 +1,13 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <string>
+
+// Runtime query of the extensions exposed by the current context.
+// The list is read once, on first use, with glGetStringi.
+class GLExtensions {
+public:
+    static bool has(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "GLStateCache.h"
+
+namespace {
+
+// Value that never matches a real GL name or enum
+const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+}
+
+GLStateCache& GLStateCache::instance() {
+    static GLStateCache cache;
+    return cache;
+}
+
+GLStateCache::GLStateCache() {
+    invalidate();
+}
+
+bool GLStateCache::update(unsigned int& cached, unsigned int value) {
+    if (cached == value) {
+        frameStats.elided++;
+        return false;
+    }
+    cached = value;
+    frameStats.issued++;
+    return true;
+}
+
+void GLStateCache::useProgram(unsigned int program) {
+    if (update(this->program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(unsigned int vao) {
+    if (update(vertexArray, vao)) {
+        glBindVertexArray(vao);
+        // The element array binding is part of the VAO
+        buffers[ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, unsigned int buffer) {
+    int slot = bufferSlot(target);
+    if (slot < 0) {
+        glBindBuffer(target, buffer);
+        frameStats.issued++;
+        return;
+    }
+    if (update(buffers[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLStateCache::bindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+    int slot = textureSlot(target);
+    if (slot < 0 || unit >= MAX_TEXTURE_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        activeUnit = unit;
+        frameStats.issued += 2;
+        return;
+    }
+    if (textures[unit][slot] == texture) {
+        frameStats.elided++;
+        return;
+    }
+    if (update(activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    update(textures[unit][slot], texture);
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindFramebuffer(unsigned int framebuffer) {
+    if (update(this->framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GLStateCache::setBlend(bool enabled) {
+    if (update(blend, enabled ? 1u : 0u)) {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+}
+
+void GLStateCache::setBlendFunc(GLenum srcFactor, GLenum dstFactor) {
+    if (blendSrc == srcFactor && blendDst == dstFactor) {
+        frameStats.elided++;
+        return;
+    }
+    blendSrc = srcFactor;
+    blendDst = dstFactor;
+    frameStats.issued++;
+    glBlendFunc(srcFactor, dstFactor);
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+    if (update(depthTest, enabled ? 1u : 0u)) {
+        if (enabled)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void GLStateCache::setViewport(int x, int y, int width, int height) {
+    if (viewportKnown && viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height) {
+        frameStats.elided++;
+        return;
+    }
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+    viewportKnown = true;
+    frameStats.issued++;
+    glViewport(x, y, width, height);
+}
+
+void GLStateCache::deleteProgram(unsigned int program) {
+    if (this->program == program)
+        this->program = UNKNOWN;
+    glDeleteProgram(program);
+}
+
+void GLStateCache::deleteVertexArray(unsigned int vao) {
+    // Deleting the bound VAO reverts the binding to zero
+    if (vertexArray == vao) {
+        vertexArray = 0;
+        buffers[ELEMENT_ARRAY] = UNKNOWN;
+    }
+    glDeleteVertexArrays(1, &vao);
+}
+
+void GLStateCache::deleteBuffer(unsigned int buffer) {
+    for (unsigned int& bound : buffers) {
+        if (bound == buffer)
+            bound = 0;
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void GLStateCache::deleteTexture(unsigned int texture) {
+    for (auto& unit : textures) {
+        for (unsigned int& bound : unit) {
+            if (bound == texture)
+                bound = 0;
+        }
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void GLStateCache::deleteFramebuffer(unsigned int framebuffer) {
+    // Deleting the bound framebuffer reverts to the default one
+    if (this->framebuffer == framebuffer)
+        this->framebuffer = 0;
+    glDeleteFramebuffers(1, &framebuffer);
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    for (unsigned int& bound : buffers)
+        bound = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (auto& unit : textures) {
+        for (unsigned int& bound : unit)
+            bound = UNKNOWN;
+    }
+    framebuffer = UNKNOWN;
+    blend = UNKNOWN;
+    blendSrc = blendDst = UNKNOWN;
+    depthTest = UNKNOWN;
+    viewportKnown = false;
+}
+
+int GLStateCache::bufferSlot(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:         return ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY;
+    case GL_PIXEL_UNPACK_BUFFER:  return PIXEL_UNPACK;
+    case GL_PIXEL_PACK_BUFFER:    return PIXEL_PACK;
+    case GL_UNIFORM_BUFFER:       return UNIFORM;
+    case GL_COPY_READ_BUFFER:     return COPY_READ;
+    case GL_COPY_WRITE_BUFFER:    return COPY_WRITE;
+    default:                      return -1;
+    }
+}
+
+int GLStateCache::textureSlot(GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D:       return TEXTURE_2D;
+    case GL_TEXTURE_2D_ARRAY: return TEXTURE_2D_ARRAY;
+    default:                  return -1;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Counters for the current frame, reset by GLStateCache::resetFrameStats()
+struct GLStateCacheStats {
+    unsigned int issued = 0; // State calls that reached the driver
+    unsigned int elided = 0; // Redundant state calls that were filtered out
+};
+
+// Shadows the GL binding and fixed-function state of the single render
+// context and drops calls that would not change anything. All code that
+// binds objects or toggles state must go through the cache, otherwise the
+// shadow copy goes stale; call invalidate() after handing the context to
+// code that does not.
+class GLStateCache {
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    // The cache for the context current on the render thread
+    static GLStateCache& instance();
+
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vao);
+    void bindBuffer(GLenum target, unsigned int buffer);
+    void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+    void bindFramebuffer(unsigned int framebuffer); // GL_FRAMEBUFFER: draw and read
+
+    void setBlend(bool enabled);
+    void setBlendFunc(GLenum srcFactor, GLenum dstFactor);
+    void setDepthTest(bool enabled);
+    void setViewport(int x, int y, int width, int height);
+
+    // Delete objects and forget them, since GL recycles names
+    void deleteProgram(unsigned int program);
+    void deleteVertexArray(unsigned int vao);
+    void deleteBuffer(unsigned int buffer);
+    void deleteTexture(unsigned int texture);
+    void deleteFramebuffer(unsigned int framebuffer);
+
+    // Mark every cached value as unknown so the next call always reaches GL
+    void invalidate();
+
+    void resetFrameStats() { frameStats = GLStateCacheStats(); }
+    const GLStateCacheStats& stats() const { return frameStats; }
+
+private:
+    GLStateCache();
+
+    // Binding points tracked for buffers and textures
+    enum BufferSlot { ARRAY, ELEMENT_ARRAY, PIXEL_UNPACK, PIXEL_PACK, UNIFORM, COPY_READ, COPY_WRITE, BUFFER_SLOT_COUNT };
+    enum TextureSlot { TEXTURE_2D, TEXTURE_2D_ARRAY, TEXTURE_SLOT_COUNT };
+
+    static int bufferSlot(GLenum target);
+    static int textureSlot(GLenum target);
+
+    // Returns true when the value changed and the call must be issued
+    bool update(unsigned int& cached, unsigned int value);
+
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int buffers[BUFFER_SLOT_COUNT];
+    unsigned int activeUnit;
+    unsigned int textures[MAX_TEXTURE_UNITS][TEXTURE_SLOT_COUNT];
+    unsigned int framebuffer;
+    unsigned int blend;
+    unsigned int blendSrc, blendDst;
+    unsigned int depthTest;
+    int viewport[4];
+    bool viewportKnown;
+
+    GLStateCacheStats frameStats;
+};
+
+#endif
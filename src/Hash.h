@@ -0,0 +1,23 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a over a null-terminated string; constexpr so names can be hashed at compile time
+constexpr uint32_t fnv1a32(const char* str, uint32_t hash = 2166136261u) {
+    return *str ? fnv1a32(str + 1, (hash ^ static_cast<uint8_t>(*str)) * 16777619u) : hash;
+}
+
+// FNV-1a over arbitrary bytes, chainable through seed
+inline uint64_t fnv1a64(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "Image.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Next PPM header token, skipping whitespace and # comments
+bool ppmToken(const uint8_t* data, size_t size, size_t& pos, std::string& token) {
+    token.clear();
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n')
+                pos++;
+        } else if (std::isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    while (pos < size && !std::isspace(data[pos]) && data[pos] != '#')
+        token += static_cast<char>(data[pos++]);
+    return !token.empty();
+}
+
+}
+
+bool decodePPM(const void* file, size_t size, Image& image) {
+    const uint8_t* data = static_cast<const uint8_t*>(file);
+    size_t pos = 0;
+    std::string magic, width, height, maxValue;
+    if (!ppmToken(data, size, pos, magic) || (magic != "P6" && magic != "P3")
+        || !ppmToken(data, size, pos, width) || !ppmToken(data, size, pos, height)
+        || !ppmToken(data, size, pos, maxValue))
+        return false;
+
+    int w = std::atoi(width.c_str()), h = std::atoi(height.c_str()), max = std::atoi(maxValue.c_str());
+    if (w <= 0 || h <= 0 || max <= 0 || max > 255)
+        return false;
+
+    std::vector<uint8_t> rgb(static_cast<size_t>(w) * h * 3);
+    if (magic == "P6") {
+        pos++; // Single whitespace after the header
+        if (size < pos + rgb.size())
+            return false;
+        std::memcpy(rgb.data(), data + pos, rgb.size());
+    } else {
+        std::string value;
+        for (uint8_t& channel : rgb) {
+            if (!ppmToken(data, size, pos, value))
+                return false;
+            channel = static_cast<uint8_t>(std::atoi(value.c_str()));
+        }
+    }
+
+    image.width = w;
+    image.height = h;
+    image.pixels.resize(static_cast<size_t>(w) * h * 4);
+    for (int y = 0; y < h; ++y) {
+        // PPM stores the top row first
+        const uint8_t* in = &rgb[static_cast<size_t>(h - 1 - y) * w * 3];
+        uint8_t* out = &image.pixels[static_cast<size_t>(y) * w * 4];
+        for (int x = 0; x < w; ++x, in += 3, out += 4) {
+            int r = in[0] * 255 / max, g = in[1] * 255 / max, b = in[2] * 255 / max;
+            out[0] = static_cast<uint8_t>(r);
+            out[1] = static_cast<uint8_t>(g);
+            out[2] = static_cast<uint8_t>(b);
+            out[3] = (r == 255 && g == 0 && b == 255) ? 0 : 255;
+        }
+    }
+    return true;
+}
+
+std::vector<uint8_t> encodePPM(const Image& image) {
+    std::string header = "P6\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+    std::vector<uint8_t> file(header.begin(), header.end());
+    file.reserve(header.size() + static_cast<size_t>(image.width) * image.height * 3);
+    for (int y = image.height - 1; y >= 0; --y) {
+        const uint8_t* in = &image.pixels[static_cast<size_t>(y) * image.width * 4];
+        for (int x = 0; x < image.width; ++x, in += 4)
+            file.insert(file.end(), in, in + 3);
+    }
+    return file;
+}
+
+ImageDiff compareImages(const Image& a, const Image& b, int tolerance) {
+    ImageDiff diff;
+    diff.sameSize = a.width == b.width && a.height == b.height;
+    if (!diff.sameSize)
+        return diff;
+    for (size_t i = 0; i < a.pixels.size(); i += 4) {
+        int error = 0;
+        for (size_t c = 0; c < 3; ++c)
+            error = std::max(error, std::abs(static_cast<int>(a.pixels[i + c]) - static_cast<int>(b.pixels[i + c])));
+        if (error > tolerance)
+            diff.differingPixels++;
+        diff.maxError = std::max(diff.maxError, error);
+    }
+    return diff;
+}
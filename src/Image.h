@@ -0,0 +1,30 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decoded RGBA8 image, rows bottom to top as GL expects
+struct Image {
+    int width = 0, height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Decode a binary (P6) or ASCII (P3) PPM. PPM has no alpha, so pure
+// magenta (255, 0, 255) becomes transparent.
+bool decodePPM(const void* data, size_t size, Image& image);
+
+// Encode as a binary (P6) PPM; alpha is dropped
+std::vector<uint8_t> encodePPM(const Image& image);
+
+struct ImageDiff {
+    bool sameSize = false;
+    size_t differingPixels = 0; // Pixels with a channel off by more than the tolerance
+    int maxError = 0;           // Largest channel difference
+};
+
+// Compare the RGB channels of two images, e.g. a capture with a golden image
+ImageDiff compareImages(const Image& a, const Image& b, int tolerance = 0);
+
+#endif
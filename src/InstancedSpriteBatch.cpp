@@ -0,0 +1,159 @@
+#include "InstancedSpriteBatch.h"
+#include "Shader.h"
+#include "GLStateCache.h"
+#include <algorithm>
+
+namespace {
+
+// Unit quad corners in triangle-strip order
+const float quadCorners[] = {
+    -0.5f, -0.5f,
+     0.5f, -0.5f,
+    -0.5f,  0.5f,
+     0.5f,  0.5f,
+};
+
+}
+
+// Constructor: creates the static quad and the per-instance stream
+InstancedSpriteBatch::InstancedSpriteBatch()
+    : instanceLayout(1), instanceStream(GL_ARRAY_BUFFER, 4 * 1024 * 1024) {
+    instanceLayout.add(1, VertexFormat::Float4)
+                  .add(2, VertexFormat::Float1)
+                  .add(3, VertexFormat::Half4)
+                  .add(4, VertexFormat::UByte4Norm)
+                  .add(5, VertexFormat::UShort2);
+    static_assert(sizeof(Instance) == 36, "Instance must match instanceLayout");
+
+    VertexLayout cornerLayout;
+    cornerLayout.add(0, VertexFormat::Float2);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &quadVBO);
+
+    GLStateCache& state = GLStateCache::instance();
+    state.bindVertexArray(VAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadCorners), quadCorners, GL_STATIC_DRAW);
+    cornerLayout.enable();
+    cornerLayout.apply();
+
+    state.bindBuffer(GL_ARRAY_BUFFER, instanceStream.ID);
+    instanceLayout.enable();
+    instanceLayout.apply();
+
+    state.bindVertexArray(0);
+}
+
+InstancedSpriteBatch::~InstancedSpriteBatch() {
+    GLStateCache::instance().deleteVertexArray(VAO);
+    GLStateCache::instance().deleteBuffer(quadVBO);
+}
+
+void InstancedSpriteBatch::begin() {
+    // Last frame's draws have been issued by now, so its instances can be fenced
+    instanceStream.endFrame();
+
+    sprites.clear();
+    entries.clear();
+    frameStats = SpriteBatchStats();
+}
+
+void InstancedSpriteBatch::draw(const Sprite& sprite, const Shader& shader) {
+    uint64_t key = (static_cast<uint64_t>(shader.ID) << 32) | sprite.texture;
+    entries.push_back({ key, static_cast<uint32_t>(sprites.size()) });
+    sprites.push_back(sprite);
+    frameStats.sprites++;
+}
+
+void InstancedSpriteBatch::end() {
+    flush(nullptr, 0);
+}
+
+void InstancedSpriteBatch::end(RenderQueue& queue, unsigned int layer) {
+    flush(&queue, layer);
+}
+
+void InstancedSpriteBatch::flush(RenderQueue* queue, unsigned int layer) {
+    if (entries.empty())
+        return;
+
+    radixSort(entries, scratch);
+
+    // Pack the instance records in sorted order so every run is contiguous
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(entries.size() * sizeof(Instance));
+    GLintptr offset = 0;
+    uint64_t stallsBefore = instanceStream.stats().stalls;
+    Instance* instances = static_cast<Instance*>(instanceStream.map(bytes, sizeof(Instance), offset));
+    frameStats.stalls += static_cast<unsigned int>(instanceStream.stats().stalls - stallsBefore);
+    if (!instances)
+        return;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Sprite& sprite = sprites[entries[i].index];
+        Instance& instance = instances[i];
+        instance.x = sprite.x;
+        instance.y = sprite.y;
+        instance.width = sprite.width;
+        instance.height = sprite.height;
+        instance.rotation = sprite.rotation;
+        instance.u0 = packHalf(sprite.u0);
+        instance.v0 = packHalf(sprite.v0);
+        instance.u1 = packHalf(sprite.u1);
+        instance.v1 = packHalf(sprite.v1);
+        instance.r = packUnorm8(sprite.r);
+        instance.g = packUnorm8(sprite.g);
+        instance.b = packUnorm8(sprite.b);
+        instance.a = packUnorm8(sprite.a);
+        instance.layer = sprite.layer;
+        instance.flags = 0;
+    }
+    instanceStream.unmap();
+    frameStats.flushes++;
+    frameStats.bytesUploaded += static_cast<unsigned int>(bytes);
+
+    size_t runStart = 0;
+    while (runStart < entries.size()) {
+        uint64_t key = entries[runStart].key;
+        size_t runEnd = runStart + 1;
+        bool translucent = sprites[entries[runStart].index].a < 1.0f;
+        while (runEnd < entries.size() && entries[runEnd].key == key) {
+            translucent = translucent || sprites[entries[runEnd].index].a < 1.0f;
+            ++runEnd;
+        }
+
+        RenderCommand command;
+        command.program = static_cast<unsigned int>(key >> 32);
+        command.texture = static_cast<unsigned int>(key & 0xFFFFFFFFu);
+        command.key = RenderKey::make(layer, translucent, command.program, command.texture, 0.0f);
+        command.textureTarget = GL_TEXTURE_2D_ARRAY;
+        command.vertexArray = VAO;
+        command.mode = GL_TRIANGLE_STRIP;
+        command.count = 4;
+        command.instanceCount = static_cast<GLsizei>(runEnd - runStart);
+
+        // GL 4.1 has no base-instance draw, so rebase the attribute pointers instead
+        command.prepare = &InstancedSpriteBatch::prepareRun;
+        command.userData = this;
+        command.userValue = static_cast<uintptr_t>(offset + runStart * sizeof(Instance));
+
+        if (queue)
+            queue->submit(command);
+        else
+            RenderQueue::execute(command);
+        frameStats.drawCalls++;
+        runStart = runEnd;
+    }
+}
+
+void InstancedSpriteBatch::prepareRun(const RenderCommand& command) {
+    InstancedSpriteBatch* batch = static_cast<InstancedSpriteBatch*>(command.userData);
+    GLStateCache::instance().bindBuffer(GL_ARRAY_BUFFER, batch->instanceStream.ID);
+    batch->setInstanceOffset(static_cast<size_t>(command.userValue));
+}
+
+// Requires the VAO and instance buffer to be bound
+void InstancedSpriteBatch::setInstanceOffset(size_t byteOffset) {
+    instanceLayout.apply(byteOffset);
+}
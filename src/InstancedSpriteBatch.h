@@ -0,0 +1,59 @@
+#ifndef INSTANCED_SPRITE_BATCH_H
+#define INSTANCED_SPRITE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "SpriteRenderer.h"
+#include "StreamBuffer.h"
+#include "RenderQueue.h"
+#include "VertexLayout.h"
+
+// Sprite backend that draws one static unit quad per sprite with
+// glDrawArraysInstanced, streaming only a compact per-instance record
+// instead of four expanded vertices.
+class InstancedSpriteBatch : public SpriteRenderer {
+public:
+    InstancedSpriteBatch();
+    ~InstancedSpriteBatch() override;
+
+    InstancedSpriteBatch(const InstancedSpriteBatch&) = delete;
+    InstancedSpriteBatch& operator=(const InstancedSpriteBatch&) = delete;
+
+    void begin() override;
+    void draw(const Sprite& sprite, const Shader& shader) override;
+    void end() override;
+    void end(RenderQueue& queue, unsigned int layer) override;
+
+    const SpriteBatchStats& stats() const override { return frameStats; }
+
+private:
+    // Per-instance attributes, advanced once per quad (divisor 1)
+    struct Instance {
+        float x, y, width, height; // location 1
+        float rotation;            // location 2
+        uint16_t u0, v0, u1, v1;   // location 3, half floats
+        uint8_t r, g, b, a;        // location 4, normalized
+        uint16_t layer, flags;     // location 5, integer
+    };
+
+    void flush(RenderQueue* queue, unsigned int layer);
+
+    // Point the instance attributes at a byte offset in the instance stream
+    void setInstanceOffset(size_t byteOffset);
+
+    // RenderCommand hook that rebases the instance attributes for one run
+    static void prepareRun(const RenderCommand& command);
+
+    unsigned int VAO = 0, quadVBO = 0;
+    VertexLayout instanceLayout;
+    StreamBuffer instanceStream;
+
+    std::vector<Sprite> sprites;
+    std::vector<SortEntry> entries; // Key is (program << 32 | texture)
+    std::vector<SortEntry> scratch;
+    SpriteBatchStats frameStats;
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Failed steal rounds before a worker goes to sleep
+const unsigned int SPIN_ROUNDS = 64;
+
+// A range is split while its thread has fewer jobs queued than this
+const int64_t SPLIT_BELOW = 2;
+
+// Ranges per thread parallelFor aims for at most
+const size_t CHUNKS_PER_THREAD = 64;
+
+// The calling thread's queue and the system it belongs to
+thread_local JobSystem* currentSystem = nullptr;
+thread_local void* currentQueue = nullptr;
+
+}
+
+bool JobSystem::Deque::push(Job* job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= static_cast<int64_t>(POOL_SIZE))
+        return false;
+    jobs[b % POOL_SIZE].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobSystem::Deque::pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = jobs[b % POOL_SIZE].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last job: race thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobSystem::Deque::steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+    Job* job = jobs[t % POOL_SIZE].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+int64_t JobSystem::Deque::size() const {
+    return bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem(unsigned int workerCount) {
+    if (workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    // Allocate every queue up front so thieves can index them without locking
+    for (unsigned int i = 0; i < workerCount + MAX_EXTERNAL_THREADS; ++i) {
+        queues.push_back(std::make_unique<ThreadQueue>());
+        queues.back()->random = 0x9E3779B9u * (i + 1);
+    }
+    queueCount = workerCount;
+    for (unsigned int i = 0; i < workerCount; ++i)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+JobSystem::ThreadQueue* JobSystem::threadQueue() {
+    if (currentSystem == this)
+        return static_cast<ThreadQueue*>(currentQueue);
+
+    unsigned int index = queueCount.load();
+    do {
+        if (index >= queues.size()) {
+            thread_local bool reported = false;
+            if (!reported) {
+                std::cerr << "ERROR::JOB_SYSTEM::TOO_MANY_THREADS\n"
+                          << "More than " << MAX_EXTERNAL_THREADS << " threads besides the workers use the job system"
+                          << std::endl;
+                reported = true;
+            }
+            return nullptr;
+        }
+    } while (!queueCount.compare_exchange_weak(index, index + 1));
+    currentSystem = this;
+    currentQueue = queues[index].get();
+    return queues[index].get();
+}
+
+Job* JobSystem::tryAllocate(Job* parent) {
+    ThreadQueue* queue = threadQueue();
+    if (!queue)
+        return nullptr;
+
+    // The ring usually wraps onto long finished jobs. A slot still alive
+    // may be an ancestor of the running job, which cannot finish before
+    // this returns, so skip it rather than wait for it.
+    for (unsigned int i = 0; i < POOL_SIZE; ++i) {
+        Job* job = &queue->pool[queue->nextJob++ % POOL_SIZE];
+        if (job->unfinished.load(std::memory_order_acquire) > 0)
+            continue;
+        job->parent = parent;
+        job->unfinished.store(1, std::memory_order_relaxed);
+        if (parent)
+            parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+    return nullptr;
+}
+
+Job* JobSystem::allocate(Job* parent) {
+    Job* job = tryAllocate(parent);
+    if (!job) {
+        // Nothing can free a job up without this thread returning, and the
+        // caller needs one now
+        if (threadQueue())
+            std::cerr << "ERROR::JOB_SYSTEM::POOL_EXHAUSTED\n"
+                      << POOL_SIZE << " jobs alive on one thread (created but never run?)" << std::endl;
+        else
+            std::cerr << "ERROR::JOB_SYSTEM::UNREGISTERED_THREAD\n"
+                      << "Only parallelFor works past MAX_EXTERNAL_THREADS threads" << std::endl;
+        std::abort();
+    }
+    return job;
+}
+
+void JobSystem::run(Job* job) {
+    ThreadQueue* queue = threadQueue();
+    if (!queue || !queue->deque.push(job)) {
+        job->function(*job);
+        finish(*job);
+        return;
+    }
+    wakeEpoch.fetch_add(1);
+    if (sleeping.load() > 0) {
+        // Taking the lock orders this after a worker's last epoch check
+        { std::lock_guard<std::mutex> lock(mutex); }
+        wake.notify_one();
+    }
+}
+
+void JobSystem::wait(const Job* job) {
+    ThreadQueue* queue = threadQueue();
+    while (job->unfinished.load(std::memory_order_acquire) > 0) {
+        Job* other = queue ? findJob(*queue) : nullptr;
+        if (other)
+            execute(*queue, *other);
+        else
+            std::this_thread::yield();
+    }
+}
+
+Job* JobSystem::findJob(ThreadQueue& queue) {
+    if (Job* job = queue.deque.pop())
+        return job;
+
+    // Steal from the others, starting at a random victim
+    unsigned int count = queueCount.load(std::memory_order_acquire);
+    queue.random ^= queue.random << 13;
+    queue.random ^= queue.random >> 17;
+    queue.random ^= queue.random << 5;
+    for (unsigned int i = 0; i < count; ++i) {
+        ThreadQueue& victim = *queues[(queue.random + i) % count];
+        if (&victim == &queue)
+            continue;
+        if (Job* job = victim.deque.steal()) {
+            queue.stolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(ThreadQueue& queue, Job& job) {
+    job.function(job);
+    finish(job);
+    queue.executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::finish(Job& job) {
+    // Read the parent first: once unfinished reaches zero the job may be reused
+    Job* parent = job.parent;
+    if (job.unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent)
+        finish(*parent);
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+    Profiler::instance().setThreadName("Job worker " + std::to_string(index + 1));
+    ThreadQueue& queue = *queues[index];
+    currentSystem = this;
+    currentQueue = &queue;
+
+    unsigned int idleRounds = 0;
+    for (;;) {
+        uint64_t epoch = wakeEpoch.load();
+        if (Job* job = findJob(queue)) {
+            execute(queue, *job);
+            idleRounds = 0;
+            continue;
+        }
+        if (++idleRounds < SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Sleep until run() queues something; a run() since epoch was read
+        // means there may be work, so look again instead
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.fetch_add(1);
+        wake.wait(lock, [&] { return stopping || wakeEpoch.load() != epoch; });
+        sleeping.fetch_sub(1);
+        if (stopping)
+            return;
+        idleRounds = 0;
+    }
+}
+
+void JobSystem::runRange(Job& job) {
+    static_assert(sizeof(Range) <= Job::DATA_SIZE, "Range does not fit in a job");
+    Range& range = *reinterpret_cast<Range*>(job.data);
+    ThreadQueue& queue = *static_cast<ThreadQueue*>(currentQueue);
+    while (range.end - range.begin > range.grain) {
+        if (queue.deque.size() < SPLIT_BELOW) {
+            // Others are short of work: give away the upper half, or work
+            // through the range here if the pool is exhausted
+            Job* half = tryAllocate(&job);
+            if (!half) {
+                range.call(range.fn, range.begin, range.end);
+                return;
+            }
+            size_t middle = range.begin + (range.end - range.begin) / 2;
+            half->function = job.function;
+            new (half->data) Range{ range.fn, range.call, middle, range.end, range.grain };
+            range.end = middle;
+            run(half);
+        } else {
+            range.call(range.fn, range.begin, range.begin + range.grain);
+            range.begin += range.grain;
+        }
+    }
+    range.call(range.fn, range.begin, range.end);
+}
+
+void JobSystem::parallelFor(size_t count, size_t minChunk, const void* fn,
+                            void (*call)(const void* fn, size_t begin, size_t end)) {
+    if (count == 0)
+        return;
+    size_t threads = workers.size() + 1;
+    size_t grain = std::max(std::max<size_t>(minChunk, 1), count / (threads * CHUNKS_PER_THREAD));
+
+    // An unregistered thread or a full pool runs the whole range here
+    Job* root = tryAllocate(nullptr);
+    if (!root) {
+        call(fn, 0, count);
+        return;
+    }
+    root->function = [](Job& job) { currentSystem->runRange(job); };
+    new (root->data) Range{ fn, call, 0, count, grain };
+    run(root);
+    wait(root);
+}
+
+JobSystemStats JobSystem::stats() const {
+    JobSystemStats total;
+    for (const std::unique_ptr<ThreadQueue>& queue : queues) {
+        total.jobs += queue->executed.load(std::memory_order_relaxed);
+        total.steals += queue->stolen.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,167 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+
+// A unit of work. Jobs live in per-thread ring pools and are never freed;
+// the callable is copied into data, so creating a job does not allocate.
+struct alignas(64) Job {
+    static const size_t DATA_SIZE = 40;
+
+    typedef void (*Function)(Job& job);
+
+    Function function = nullptr;
+    Job* parent = nullptr;
+    std::atomic<int32_t> unfinished{ 0 }; // This job plus its unfinished children
+    alignas(8) unsigned char data[DATA_SIZE];
+};
+
+struct JobSystemStats {
+    uint64_t jobs = 0;   // Executed since startup
+    uint64_t steals = 0; // Of those, taken from another thread's deque
+};
+
+// Work-stealing job scheduler. Each thread that creates jobs owns a
+// Chase-Lev deque: it pushes and pops at the bottom without locking while
+// idle threads steal from the top, so work spreads out without a shared
+// queue to contend on. A job finishes once it and all the children created
+// with it as parent have finished, which is what wait() waits for; waiting
+// threads execute other jobs meanwhile instead of blocking.
+//
+// Jobs may be created from the worker threads and from up to
+// MAX_EXTERNAL_THREADS other threads (the main and simulation threads);
+// further threads can only call parallelFor, which then runs inline.
+// A thread may have at most POOL_SIZE jobs alive at once; a job is alive
+// from createJob() until it and its children have finished, so every
+// created job must be passed to run().
+class JobSystem {
+public:
+    static const unsigned int POOL_SIZE = 4096;          // Jobs per thread, also the deque capacity
+    static const unsigned int MAX_EXTERNAL_THREADS = 4;
+
+    // workerCount 0 picks one less than the hardware threads, leaving a
+    // core for the GL thread
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Create a job that calls fn(). fn is copied into the job, so it must
+    // be small and trivially copyable (a lambda capturing a few pointers or
+    // values). With a parent, the parent does not finish before this job.
+    // Creating more than POOL_SIZE live jobs on one thread is an error.
+    template <typename Fn>
+    Job* createJob(const Fn& fn, Job* parent = nullptr);
+
+    // Queue a job on the calling thread's deque
+    void run(Job* job);
+
+    // Execute jobs until job has finished
+    void wait(const Job* job);
+
+    // Call fn(begin, end) on disjoint ranges covering [0, count) across all
+    // threads and return when every range is done. Ranges are split lazily:
+    // a range is halved only while the thread's own deque is nearly empty,
+    // meaning others are idle, and otherwise worked through in chunks of
+    // at least minChunk.
+    template <typename Fn>
+    void parallelFor(size_t count, const Fn& fn, size_t minChunk = 1);
+
+    unsigned int workerCount() const { return static_cast<unsigned int>(workers.size()); }
+
+    JobSystemStats stats() const;
+
+private:
+    // Chase-Lev deque. The owner pushes and pops at bottom, thieves take
+    // from top; only taking the last job needs a compare-and-swap.
+    class Deque {
+    public:
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+        int64_t size() const;
+
+    private:
+        // Thieves compare-and-swap top while the owner writes bottom; on
+        // one cache line every push and pop would bounce it between cores
+        alignas(64) std::atomic<int64_t> top{ 0 };
+        alignas(64) std::atomic<int64_t> bottom{ 0 };
+        alignas(64) std::atomic<Job*> jobs[POOL_SIZE];
+    };
+
+    struct ThreadQueue {
+        Deque deque;
+        Job pool[POOL_SIZE];
+        uint32_t nextJob = 0;     // Owner only
+        uint32_t random = 0;      // Owner only, picks steal victims
+        std::atomic<uint64_t> executed{ 0 };
+        std::atomic<uint64_t> stolen{ 0 };
+    };
+
+    // Parameters of a parallelFor range, stored in the job's data
+    struct Range {
+        const void* fn;
+        void (*call)(const void* fn, size_t begin, size_t end);
+        size_t begin, end;
+        size_t grain;
+    };
+
+    // The calling thread's queue, registering it on first use; nullptr if
+    // too many threads use the system
+    ThreadQueue* threadQueue();
+
+    // A free job from the calling thread's pool, nullptr if all POOL_SIZE
+    // are alive or the thread has no pool
+    Job* tryAllocate(Job* parent);
+    Job* allocate(Job* parent);
+    Job* findJob(ThreadQueue& queue);
+    void execute(ThreadQueue& queue, Job& job);
+    void finish(Job& job);
+    void workerLoop(unsigned int index);
+    void runRange(Job& job);
+    void parallelFor(size_t count, size_t minChunk, const void* fn,
+                     void (*call)(const void* fn, size_t begin, size_t end));
+
+    std::vector<std::unique_ptr<ThreadQueue>> queues; // Workers first, then external threads
+    std::atomic<unsigned int> queueCount{ 0 };        // Registered so far
+    std::vector<std::thread> workers;
+
+    std::mutex mutex; // Guards sleeping workers
+    std::condition_variable wake;
+    std::atomic<uint64_t> wakeEpoch{ 0 }; // Bumped by run(), so a worker never sleeps through one
+    std::atomic<unsigned int> sleeping{ 0 };
+    bool stopping = false;
+};
+
+template <typename Fn>
+Job* JobSystem::createJob(const Fn& fn, Job* parent) {
+    static_assert(sizeof(Fn) <= Job::DATA_SIZE, "Job function too large, capture less or by reference");
+    static_assert(alignof(Fn) <= 8, "Job function over-aligned");
+    static_assert(std::is_trivially_copyable<Fn>::value, "Job function must be trivially copyable");
+    Job* job = allocate(parent);
+    new (job->data) Fn(fn);
+    job->function = [](Job& job) { (*reinterpret_cast<Fn*>(job.data))(); };
+    return job;
+}
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t count, const Fn& fn, size_t minChunk) {
+    parallelFor(count, minChunk, &fn, [](const void* fn, size_t begin, size_t end) {
+        (*static_cast<const Fn*>(fn))(begin, end);
+    });
+}
+
+#endif
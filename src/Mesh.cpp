@@ -0,0 +1,251 @@
+#include "Mesh.h"
+#include "GLStateCache.h"
+#include "Hash.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Cache the optimizer models; larger than real post-transform caches so it
+// also does well on hardware that batches vertices differently
+const int OPTIMIZER_CACHE_SIZE = 32;
+
+// Forsyth's vertex score: recently used vertices score high (the three of
+// the last triangle a bit lower, to avoid strips), and vertices with few
+// triangles left are boosted so they get finished off
+float vertexScore(int cachePosition, uint32_t remaining) {
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(OPTIMIZER_CACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2.0f / std::sqrt(static_cast<float>(remaining));
+}
+
+}
+
+MeshBuilder::MeshBuilder(size_t vertexSize) : stride(vertexSize) {}
+
+void MeshBuilder::addVertex(const void* vertex) {
+    uint64_t hash = fnv1a64(vertex, stride);
+    auto range = weld.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (std::memcmp(&vertices[it->second * stride], vertex, stride) == 0) {
+            indexList.push_back(it->second);
+            return;
+        }
+    }
+
+    uint32_t index = static_cast<uint32_t>(vertexCount());
+    const unsigned char* bytes = static_cast<const unsigned char*>(vertex);
+    vertices.insert(vertices.end(), bytes, bytes + stride);
+    weld.emplace(hash, index);
+    indexList.push_back(index);
+}
+
+void MeshBuilder::optimize() {
+    size_t triangleCount = indexList.size() / 3;
+    size_t count = vertexCount();
+    if (triangleCount == 0)
+        return;
+
+    // Triangles using each vertex, packed per vertex; the first remaining[v]
+    // entries are the ones not emitted yet
+    std::vector<uint32_t> offsets(count + 1, 0);
+    for (uint32_t index : indexList)
+        offsets[index + 1]++;
+    for (size_t i = 0; i < count; ++i)
+        offsets[i + 1] += offsets[i];
+    std::vector<uint32_t> adjacency(indexList.size());
+    std::vector<uint32_t> remaining(count, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        uint32_t v = indexList[i];
+        adjacency[offsets[v] + remaining[v]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cachePosition(count, -1);
+    std::vector<float> score(count);
+    for (size_t v = 0; v < count; ++v)
+        score[v] = vertexScore(-1, remaining[v]);
+
+    auto triangleScore = [&](uint32_t t) {
+        return score[indexList[t * 3]] + score[indexList[t * 3 + 1]] + score[indexList[t * 3 + 2]];
+    };
+
+    // Start from the best triangle overall
+    std::vector<bool> emitted(triangleCount, false);
+    int best = 0;
+    float bestScore = -1.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        float s = triangleScore(t);
+        if (s > bestScore) {
+            bestScore = s;
+            best = static_cast<int>(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache, nextCache;
+    size_t scanCursor = 0;
+
+    for (size_t done = 0; done < triangleCount; ++done) {
+        if (best < 0) {
+            // Nothing left next to the cache: continue with any unemitted triangle
+            while (emitted[scanCursor])
+                scanCursor++;
+            best = static_cast<int>(scanCursor);
+        }
+
+        emitted[best] = true;
+        const uint32_t* triangle = &indexList[best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Drop the triangle from its vertices' lists
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            uint32_t* first = &adjacency[offsets[v]];
+            uint32_t* last = first + remaining[v];
+            uint32_t* found = std::find(first, last, static_cast<uint32_t>(best));
+            if (found != last) {
+                *found = *(last - 1);
+                remaining[v]--;
+            }
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                nextCache.push_back(v);
+        }
+
+        // The triangle's vertices move to the front of the cache
+        size_t front = nextCache.size();
+        for (uint32_t v : cache) {
+            if (std::find(nextCache.begin(), nextCache.begin() + front, v) == nextCache.begin() + front)
+                nextCache.push_back(v);
+        }
+
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            uint32_t v = nextCache[i];
+            cachePosition[v] = i < OPTIMIZER_CACHE_SIZE ? static_cast<int>(i) : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Only triangles touching the cache changed score; take the best of them
+        best = -1;
+        bestScore = -1.0f;
+        for (uint32_t v : nextCache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                uint32_t t = adjacency[offsets[v] + i];
+                float s = triangleScore(t);
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = static_cast<int>(t);
+                }
+            }
+        }
+
+        if (nextCache.size() > OPTIMIZER_CACHE_SIZE)
+            nextCache.resize(OPTIMIZER_CACHE_SIZE);
+        cache.swap(nextCache);
+    }
+
+    // Renumber vertices in the order the new index list first uses them
+    std::vector<uint32_t> remap(count, UINT32_MAX);
+    uint32_t next = 0;
+    for (uint32_t& index : output) {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<unsigned char> reordered(vertices.size());
+    for (size_t v = 0; v < count; ++v) {
+        if (remap[v] != UINT32_MAX)
+            std::memcpy(&reordered[remap[v] * stride], &vertices[v * stride], stride);
+    }
+    reordered.resize(next * stride);
+
+    vertices.swap(reordered);
+    indexList.swap(output);
+    weld.clear();
+    for (uint32_t v = 0; v < next; ++v)
+        weld.emplace(fnv1a64(&vertices[v * stride], stride), v);
+}
+
+float MeshBuilder::acmr(unsigned int cacheSize) const {
+    size_t triangleCount = indexList.size() / 3;
+    if (triangleCount == 0 || cacheSize == 0)
+        return 0.0f;
+
+    std::vector<uint32_t> fifo(cacheSize, UINT32_MAX);
+    size_t head = 0, misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        uint32_t index = indexList[i];
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+            continue;
+        fifo[head] = index;
+        head = (head + 1) % cacheSize;
+        misses++;
+    }
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+// Constructor: uploads the welded vertices and indices and sets up the vertex layout
+Mesh::Mesh(const MeshBuilder& builder, const VertexLayout& layout) {
+    const std::vector<uint32_t>& indices = builder.indices();
+    indexCount = static_cast<GLsizei>(indices.size());
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    GLStateCache& state = GLStateCache::instance();
+    state.bindVertexArray(VAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, builder.vertexData().size(), builder.vertexData().data(), GL_STATIC_DRAW);
+
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (builder.vertexCount() <= 65536) {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short),
+                     shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    }
+
+    layout.enable();
+    layout.apply();
+
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    state.bindVertexArray(0); // Unbind VAO (keeps the EBO binding)
+}
+
+Mesh::~Mesh() {
+    GLStateCache& state = GLStateCache::instance();
+    state.deleteVertexArray(VAO);
+    state.deleteBuffer(VBO);
+    state.deleteBuffer(EBO);
+}
+
+void Mesh::draw() const {
+    GLStateCache::instance().bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)0);
+}
+
+void Mesh::setupCommand(RenderCommand& command) const {
+    command.vertexArray = VAO;
+    command.mode = GL_TRIANGLES;
+    command.indexType = indexType;
+    command.first = 0;
+    command.baseVertex = 0;
+    command.count = indexCount;
+}
@@ -0,0 +1,38 @@
+#include "OffscreenTarget.h"
+#include "GLStateCache.h"
+#include "Image.h"
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget(int width, int height)
+    : ID(0), targetWidth(width), targetHeight(height) {
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &ID);
+    GLStateCache::instance().bindFramebuffer(ID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+        std::cerr << "ERROR::OFFSCREEN_TARGET::INCOMPLETE_FRAMEBUFFER" << std::endl;
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    GLStateCache::instance().deleteFramebuffer(ID);
+    glDeleteRenderbuffers(1, &colorBuffer);
+}
+
+void OffscreenTarget::bind() const {
+    GLStateCache::instance().bindFramebuffer(ID);
+}
+
+void OffscreenTarget::readPixels(Image& image) const {
+    GLStateCache& state = GLStateCache::instance();
+    state.bindFramebuffer(ID);
+    state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    image.width = targetWidth;
+    image.height = targetHeight;
+    image.pixels.resize(static_cast<size_t>(targetWidth) * targetHeight * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, targetWidth, targetHeight, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+}
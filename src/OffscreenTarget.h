@@ -0,0 +1,39 @@
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+struct Image;
+
+// RGBA8 framebuffer object to render into instead of the window. The
+// default framebuffer of a hidden window has undefined contents (its
+// pixels fail the ownership test), so headless runs draw here and read
+// the result back.
+class OffscreenTarget {
+public:
+    unsigned int ID; // Framebuffer object
+
+    OffscreenTarget(int width, int height);
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // Make this the draw and read framebuffer
+    void bind() const;
+
+    // False if the driver rejected the attachment
+    bool isComplete() const { return complete; }
+
+    // Copy the color buffer into image, rows bottom to top. Waits for
+    // rendering to finish.
+    void readPixels(Image& image) const;
+
+    int width() const { return targetWidth; }
+    int height() const { return targetHeight; }
+
+private:
+    unsigned int colorBuffer = 0; // Renderbuffer
+    int targetWidth, targetHeight;
+    bool complete = false;
+};
+
+#endif
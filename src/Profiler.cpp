@@ -0,0 +1,194 @@
+#include "Profiler.h"
+#include <chrono>
+#include <glad/glad.h>
+
+namespace {
+
+const char* const FRAME_SCOPE = "Frame";
+
+// The calling thread's buffer in the profiler; buffers are never freed, so
+// events of a thread that has exited can still be drained
+thread_local void* currentThreadBuffer = nullptr;
+
+double seconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) * 1e-9;
+}
+
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+uint64_t Profiler::now() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer() {
+    if (!currentThreadBuffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.push_back(std::make_unique<ThreadBuffer>());
+        threads.back()->index = static_cast<uint32_t>(threads.size() - 1);
+        currentThreadBuffer = threads.back().get();
+    }
+    return *static_cast<ThreadBuffer*>(currentThreadBuffer);
+}
+
+uint32_t Profiler::threadIndex() {
+    return threadBuffer().index;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.name = name;
+}
+
+std::vector<std::string> Profiler::threadNames() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+        names.push_back(buffer->name);
+    return names;
+}
+
+uint32_t Profiler::beginScope() {
+    return threadBuffer().depth++;
+}
+
+void Profiler::endScope(const char* name, uint64_t start, uint32_t depth) {
+    uint64_t end = now();
+    ThreadBuffer& buffer = threadBuffer();
+    buffer.depth = depth;
+
+    // Single producer: only this thread moves head, endFrame() moves tail
+    uint32_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= THREAD_BUFFER_SIZE) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[head % THREAD_BUFFER_SIZE] = { name, start, end, buffer.index, depth };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::beginFrame() {
+    frameIndex++;
+    frameStart = now();
+    swapStart = 0;
+    frameCounters.clear();
+
+    // Reuse the queries of the frame GPU_LATENCY frames back. If the GPU
+    // still has not finished it, skip timing this frame rather than wait.
+    GpuFrame& gpuFrame = gpuFrames[frameIndex % GPU_LATENCY];
+    if (gpuFrame.pending && !resolveGpuFrame(gpuFrame)) {
+        counters.skippedGpuFrames++;
+        recording = nullptr;
+        return;
+    }
+    recording = &gpuFrame;
+    recording->frame = frameIndex;
+    recording->used = 0;
+    gpuDepth = 0;
+    beginGpuScope(FRAME_SCOPE);
+}
+
+void Profiler::markSwap() {
+    swapStart = now();
+}
+
+void Profiler::endFrame() {
+    uint64_t frameEnd = now();
+    if (recording) {
+        endGpuScope(0); // FRAME_SCOPE
+        recording->pending = true;
+        recording = nullptr;
+    }
+
+    // Drain every thread's events
+    frameEvents.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : threads) {
+            uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint32_t head = buffer->head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail)
+                frameEvents.push_back(buffer->events[tail % THREAD_BUFFER_SIZE]);
+            buffer->tail.store(tail, std::memory_order_release);
+            counters.droppedEvents += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+    if (swapStart == 0)
+        swapStart = frameEnd;
+    frameProfile.frame = frameIndex;
+    frameProfile.start = frameStart;
+    frameProfile.end = frameEnd;
+    frameProfile.cpu = seconds(swapStart - frameStart);
+    frameProfile.swap = seconds(frameEnd - swapStart);
+}
+
+void Profiler::recordCounter(const char* name, double value) {
+    frameCounters.push_back({ name, now(), value });
+}
+
+int Profiler::beginGpuScope(const char* name) {
+    if (!recording)
+        return -1;
+    if (recording->used == recording->scopes.size()) {
+        GpuScope scope;
+        glGenQueries(1, &scope.begin);
+        glGenQueries(1, &scope.end);
+        recording->scopes.push_back(scope);
+    }
+    int index = static_cast<int>(recording->used++);
+    GpuScope& scope = recording->scopes[index];
+    scope.name = name;
+    scope.depth = gpuDepth++;
+    glQueryCounter(scope.begin, GL_TIMESTAMP);
+    return index;
+}
+
+void Profiler::endGpuScope(int index) {
+    if (!recording || index < 0)
+        return;
+    GpuScope& scope = recording->scopes[index];
+    gpuDepth = scope.depth;
+    glQueryCounter(scope.end, GL_TIMESTAMP);
+}
+
+bool Profiler::resolveGpuFrame(GpuFrame& gpuFrame) {
+    // The frame scope ends after every other query and queries complete in
+    // order, so its result being there means all of them are
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(gpuFrame.scopes[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    resolvedGpuEvents.clear();
+    for (size_t i = 0; i < gpuFrame.used; ++i) {
+        const GpuScope& scope = gpuFrame.scopes[i];
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+        resolvedGpuEvents.push_back({ scope.name, start, end, scope.depth });
+    }
+    gpuFrame.pending = false;
+
+    const GpuProfileEvent& frame = resolvedGpuEvents.front();
+    frameProfile.gpu = seconds(frame.end - frame.start);
+    frameProfile.gpuFrame = gpuFrame.frame;
+    return true;
+}
+
+void Profiler::releaseQueries() {
+    for (GpuFrame& gpuFrame : gpuFrames) {
+        for (const GpuScope& scope : gpuFrame.scopes) {
+            glDeleteQueries(1, &scope.begin);
+            glDeleteQueries(1, &scope.end);
+        }
+        gpuFrame = GpuFrame();
+    }
+    recording = nullptr;
+}
@@ -0,0 +1,203 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A finished CPU scope. Times are steady_clock nanoseconds.
+struct ProfileEvent {
+    const char* name;      // String literal, compared by pointer
+    uint64_t start, end;
+    uint32_t thread;       // Index into Profiler::threadNames()
+    uint32_t depth;        // Scopes open on the thread when this one began
+};
+
+// A finished GPU scope. Times are GL_TIMESTAMP nanoseconds, a different
+// clock from the CPU events.
+struct GpuProfileEvent {
+    const char* name;
+    uint64_t start, end;
+    uint32_t depth;
+};
+
+// A value sampled once in a frame, e.g. draw calls or queue depth
+struct ProfileCounter {
+    const char* name;
+    uint64_t time; // steady_clock nanoseconds
+    double value;
+};
+
+// Timing of one frame, in seconds
+struct FrameProfile {
+    uint64_t frame = 0;
+    uint64_t start = 0, end = 0; // steady_clock nanoseconds of beginFrame() and endFrame()
+    double cpu = 0.0;      // beginFrame() to markSwap()
+    double swap = 0.0;     // markSwap() to endFrame(): present and event polling
+    double gpu = 0.0;      // GPU time of frame gpuFrame, a few frames older
+    uint64_t gpuFrame = 0; // 0 until the first GPU results come back
+};
+
+struct ProfilerStats {
+    unsigned int droppedEvents = 0;     // CPU events lost to a full thread buffer
+    unsigned int skippedGpuFrames = 0;  // Frames not timed because old queries were still pending
+};
+
+// Frame profiler. CPU scopes (PROFILE_SCOPE) may be opened on any thread;
+// each thread writes its events into its own single-producer ring buffer
+// without locking, and endFrame() drains them all on the main thread. GPU
+// scopes (PROFILE_GPU_SCOPE) bracket GL commands with timestamp queries,
+// which are read GPU_LATENCY frames later, once the GPU has long finished
+// them, so the CPU never waits for results.
+//
+// Per frame, on the thread that owns the GL context:
+//   beginFrame() ... scopes ... markSwap(); glfwSwapBuffers(); glfwPollEvents(); endFrame()
+class Profiler {
+public:
+    static const unsigned int GPU_LATENCY = 4;          // Frames in flight before results are read
+    static const unsigned int THREAD_BUFFER_SIZE = 8192; // Events per thread between two endFrame() calls
+
+    static Profiler& instance();
+
+    void beginFrame();
+    void markSwap();
+    void endFrame();
+
+    // Sample a counter for this frame. Main thread, between beginFrame()
+    // and endFrame().
+    void recordCounter(const char* name, double value);
+
+    // Delete the query objects. Call before the GL context goes away.
+    void releaseQueries();
+
+    // Name the calling thread in captures
+    void setThreadName(const std::string& name);
+
+    // Index of the calling thread's buffer, registering it on first use
+    uint32_t threadIndex();
+
+    // Record a CPU scope from any thread; ProfileScope calls these
+    uint32_t beginScope();
+    void endScope(const char* name, uint64_t start, uint32_t depth);
+
+    // GPU scopes on the GL thread; GpuProfileScope calls these. Returns an
+    // index for endGpuScope(), or -1 if this frame is not being timed.
+    int beginGpuScope(const char* name);
+    void endGpuScope(int index);
+
+    // Current steady_clock time in nanoseconds
+    static uint64_t now();
+
+    // Summary of the last finished frame
+    const FrameProfile& lastFrame() const { return frameProfile; }
+
+    // CPU events drained by the last endFrame(), from every thread
+    const std::vector<ProfileEvent>& events() const { return frameEvents; }
+
+    // Counters recorded in the last frame
+    const std::vector<ProfileCounter>& counterValues() const { return frameCounters; }
+
+    // GPU scopes of frame lastFrame().gpuFrame
+    const std::vector<GpuProfileEvent>& gpuEvents() const { return resolvedGpuEvents; }
+
+    // Names given with setThreadName, by thread index ("" if unnamed)
+    std::vector<std::string> threadNames();
+
+    const ProfilerStats& stats() const { return counters; }
+
+private:
+    struct ThreadBuffer {
+        ProfileEvent events[THREAD_BUFFER_SIZE];
+        std::atomic<uint32_t> head{ 0 }; // Next slot the owning thread writes
+        std::atomic<uint32_t> tail{ 0 }; // Next slot endFrame() reads
+        std::atomic<unsigned int> dropped{ 0 };
+        uint32_t index = 0;
+        uint32_t depth = 0;              // Owning thread only
+        std::string name;                // Guarded by Profiler::mutex
+    };
+
+    struct GpuScope {
+        const char* name = nullptr;
+        unsigned int begin = 0, end = 0; // Timestamp query objects, reused
+        uint32_t depth = 0;
+    };
+
+    // Queries of one frame, reused every GPU_LATENCY frames
+    struct GpuFrame {
+        uint64_t frame = 0;
+        std::vector<GpuScope> scopes; // Grows to the most scopes seen in a frame
+        size_t used = 0;
+        bool pending = false;         // Issued, results not read yet
+    };
+
+    Profiler() = default;
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    ThreadBuffer& threadBuffer();
+
+    // Read a frame's results if the GPU has finished it; false if not yet
+    bool resolveGpuFrame(GpuFrame& gpuFrame);
+
+    std::mutex mutex; // Guards threads (registration and names)
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+    uint64_t frameIndex = 0;
+    uint64_t frameStart = 0, swapStart = 0;
+    GpuFrame gpuFrames[GPU_LATENCY];
+    GpuFrame* recording = nullptr; // Frame taking GPU scopes, nullptr if skipped
+    uint32_t gpuDepth = 0;
+
+    FrameProfile frameProfile;
+    std::vector<ProfileEvent> frameEvents;
+    std::vector<ProfileCounter> frameCounters;
+    std::vector<GpuProfileEvent> resolvedGpuEvents;
+    ProfilerStats counters;
+};
+
+// Times the enclosing block on the calling thread
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name(name), depth(Profiler::instance().beginScope()), start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::instance().endScope(name, start, depth); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint32_t depth;
+    uint64_t start;
+};
+
+// Times the GL commands issued in the enclosing block on the GPU
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char* name) : index(Profiler::instance().beginGpuScope(name)) {}
+    ~GpuProfileScope() { Profiler::instance().endGpuScope(index); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    int index;
+};
+
+// Scope macros compile to nothing unless the GAMEENGINE_PROFILER option is on.
+// name must be a string literal.
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef GAMEENGINE_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include "ProgramBinaryCache.h"
+#include "Hash.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// File layout: header followed by the driver's binary blob
+struct CacheHeader {
+    char magic[4];      // "GEPB"
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;    // Binary format enum returned by glGetProgramBinary
+    uint32_t length;    // Bytes of binary data that follow
+};
+
+const uint32_t CACHE_VERSION = 1;
+
+void appendString(uint64_t& hash, const GLubyte* str) {
+    const char* text = str ? reinterpret_cast<const char*>(str) : "";
+    hash = fnv1a64(text, std::char_traits<char>::length(text) + 1, hash);
+}
+
+}
+
+ProgramBinaryCache& ProgramBinaryCache::instance() {
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+void ProgramBinaryCache::setDirectory(const std::string& directory) {
+    cacheDirectory = directory;
+    if (cacheDirectory.empty())
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    if (error) {
+        std::cerr << "ERROR::PROGRAM_BINARY_CACHE::CANNOT_CREATE_DIRECTORY\n" << cacheDirectory << std::endl;
+        cacheDirectory.clear();
+        return;
+    }
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    supported = formats > 0;
+}
+
+uint64_t ProgramBinaryCache::key(const std::string& vertexCode, const std::string& fragmentCode) {
+    if (driverHash == 0) {
+        driverHash = fnv1a64(&CACHE_VERSION, sizeof(CACHE_VERSION));
+        appendString(driverHash, glGetString(GL_VENDOR));
+        appendString(driverHash, glGetString(GL_RENDERER));
+        appendString(driverHash, glGetString(GL_VERSION));
+    }
+
+    // Include the lengths so moving text between the stages changes the key
+    uint64_t hash = driverHash;
+    uint64_t lengths[2] = { vertexCode.size(), fragmentCode.size() };
+    hash = fnv1a64(lengths, sizeof(lengths), hash);
+    hash = fnv1a64(vertexCode.data(), vertexCode.size(), hash);
+    hash = fnv1a64(fragmentCode.data(), fragmentCode.size(), hash);
+    return hash;
+}
+
+bool ProgramBinaryCache::load(uint64_t key, unsigned int program) {
+    if (!enabled())
+        return false;
+
+    std::string path = pathFor(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        counters.misses++;
+        return false;
+    }
+
+    CacheHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        && std::char_traits<char>::compare(header.magic, "GEPB", 4) == 0
+        && header.version == CACHE_VERSION
+        && header.key == key;
+    if (valid) {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), header.length));
+    }
+    file.close();
+
+    GLint linked = GL_FALSE;
+    if (valid) {
+        glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+
+    if (!linked) {
+        // Corrupt, truncated or rejected by the driver: drop it and rebuild
+        std::remove(path.c_str());
+        counters.invalidated++;
+        counters.misses++;
+        return false;
+    }
+
+    counters.hits++;
+    return true;
+}
+
+void ProgramBinaryCache::store(uint64_t key, unsigned int program) {
+    if (!enabled())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    CacheHeader header = { { 'G', 'E', 'P', 'B' }, CACHE_VERSION, key, format, static_cast<uint32_t>(length) };
+
+    // Write to a temporary name first so a crash never leaves a torn entry
+    std::string path = pathFor(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            std::cerr << "ERROR::PROGRAM_BINARY_CACHE::WRITE_FAILED\n" << temporary << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (!error)
+        counters.stored++;
+}
+
+std::string ProgramBinaryCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return cacheDirectory + "/" + name;
+}
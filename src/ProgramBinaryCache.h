@@ -0,0 +1,54 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+
+// Counters since startup
+struct ProgramBinaryCacheStats {
+    unsigned int hits = 0;          // Programs restored from disk
+    unsigned int misses = 0;        // No usable entry, compiled from source
+    unsigned int invalidated = 0;   // Entries the driver rejected and that were removed
+    unsigned int stored = 0;        // Entries written
+};
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources and the driver's
+// vendor, renderer and version strings, so a driver update or an edited
+// shader simply misses; a binary the driver refuses is deleted and the
+// caller falls back to compiling from source.
+class ProgramBinaryCache {
+public:
+    // The cache shared by every Shader
+    static ProgramBinaryCache& instance();
+
+    // Directory holding the cache files; empty (the default) disables the cache
+    void setDirectory(const std::string& directory);
+    bool enabled() const { return !cacheDirectory.empty() && supported; }
+
+    // Key for a program built from the given sources on the current driver.
+    // Requires a current GL context.
+    uint64_t key(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Try to restore program from the cache. Returns true if it linked.
+    bool load(uint64_t key, unsigned int program);
+
+    // Save a linked program. It must have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    void store(uint64_t key, unsigned int program);
+
+    const ProgramBinaryCacheStats& stats() const { return counters; }
+
+private:
+    ProgramBinaryCache() = default;
+
+    std::string pathFor(uint64_t key) const;
+
+    std::string cacheDirectory;
+    bool supported = false;       // Driver exposes at least one binary format
+    uint64_t driverHash = 0;      // Hash of vendor/renderer/version, 0 = not queried yet
+    ProgramBinaryCacheStats counters;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include <atomic>
+
+namespace {
+
+std::atomic<uint64_t> nextQueueSerial{ 1 };
+
+// Last bucket used by this thread, so steady-state submits skip the lock
+struct BucketCache {
+    uint64_t serial = 0;
+    void* bucket = nullptr;
+};
+thread_local BucketCache bucketCache;
+
+}
+
+unsigned int radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    const size_t n = entries.size();
+    if (n < 2)
+        return 0;
+    scratch.resize(n);
+
+    // Build all eight histograms in one pass over the keys
+    uint32_t counts[8][256] = {};
+    for (const SortEntry& entry : entries) {
+        uint64_t key = entry.key;
+        for (int digit = 0; digit < 8; ++digit)
+            counts[digit][(key >> (digit * 8)) & 0xFF]++;
+    }
+
+    unsigned int passes = 0;
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+    for (int digit = 0; digit < 8; ++digit) {
+        uint32_t* count = counts[digit];
+        // Every key shares this digit: the pass would not move anything
+        if (count[(src[0].key >> (digit * 8)) & 0xFF] == n)
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (int i = 0; i < 256; ++i) {
+            offsets[i] = sum;
+            sum += count[i];
+        }
+        for (size_t i = 0; i < n; ++i)
+            dst[offsets[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+
+        std::swap(src, dst);
+        passes++;
+    }
+
+    if (src != entries.data())
+        entries.swap(scratch);
+    return passes;
+}
+
+RenderQueue::RenderQueue() : serial(nextQueueSerial++) {}
+
+RenderQueue::~RenderQueue() = default;
+
+void RenderQueue::clear() {
+    for (auto& bucket : buckets)
+        bucket->commands.clear();
+    frameStats = RenderQueueStats();
+}
+
+RenderQueue::Bucket& RenderQueue::localBucket() {
+    if (bucketCache.serial == serial)
+        return *static_cast<Bucket*>(bucketCache.bucket);
+
+    std::lock_guard<std::mutex> lock(bucketsMutex);
+    Bucket*& bucket = bucketByThread[std::this_thread::get_id()];
+    if (!bucket) {
+        buckets.push_back(std::make_unique<Bucket>());
+        bucket = buckets.back().get();
+    }
+    bucketCache.serial = serial;
+    bucketCache.bucket = bucket;
+    return *bucket;
+}
+
+void RenderQueue::submit(const RenderCommand& command) {
+    localBucket().commands.push_back(command);
+}
+
+void RenderQueue::sort() {
+    PROFILE_SCOPE("Sort render queue");
+    commandRefs.clear();
+    entries.clear();
+    for (auto& bucket : buckets) {
+        if (bucket->commands.empty())
+            continue;
+        frameStats.buckets++;
+        for (const RenderCommand& command : bucket->commands) {
+            entries.push_back({ command.key, static_cast<uint32_t>(commandRefs.size()) });
+            commandRefs.push_back(&command);
+        }
+    }
+    frameStats.commands = static_cast<unsigned int>(entries.size());
+    frameStats.sortPasses = radixSort(entries, scratch);
+}
+
+void RenderQueue::execute() {
+    PROFILE_SCOPE("Execute render queue");
+    PROFILE_GPU_SCOPE("Render queue");
+    for (const SortEntry& entry : entries)
+        execute(*commandRefs[entry.index]);
+}
+
+void RenderQueue::execute(const RenderCommand& command) {
+    GLStateCache& state = GLStateCache::instance();
+
+    bool translucent = RenderKey::translucent(command.key);
+    state.setBlend(translucent);
+    if (translucent)
+        state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    state.useProgram(command.program);
+    state.bindVertexArray(command.vertexArray);
+    if (command.texture != 0)
+        state.bindTexture(0, command.textureTarget, command.texture);
+
+    if (command.prepare)
+        command.prepare(command);
+
+    if (command.indexType == 0) {
+        if (command.instanceCount > 0)
+            glDrawArraysInstanced(command.mode, command.first, command.count, command.instanceCount);
+        else
+            glDrawArrays(command.mode, command.first, command.count);
+    } else {
+        const void* indices = (const void*)static_cast<intptr_t>(command.first);
+        if (command.instanceCount > 0)
+            glDrawElementsInstancedBaseVertex(command.mode, command.count, command.indexType, indices,
+                                              command.instanceCount, command.baseVertex);
+        else
+            glDrawElementsBaseVertex(command.mode, command.count, command.indexType, indices,
+                                     command.baseVertex);
+    }
+}
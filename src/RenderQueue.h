@@ -0,0 +1,127 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+// Packs draw state into a 64-bit sort key. From the most significant bit:
+//   opaque:      layer(8) | 0 | shader(12) | texture(16) | depth(24) | 0(3)
+//   translucent: layer(8) | 1 | ~depth(24) | shader(12) | texture(16) | 0(3)
+// Opaque draws group by state and go front to back; translucent draws go
+// back to front so blending stays correct.
+namespace RenderKey {
+
+inline uint64_t make(unsigned int layer, bool translucent, unsigned int shader,
+                     unsigned int texture, float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    uint64_t d = static_cast<uint64_t>(depth * 16777215.0f) & 0xFFFFFFu;
+    uint64_t s = shader & 0xFFFu;
+    uint64_t t = texture & 0xFFFFu;
+    uint64_t key = static_cast<uint64_t>(layer & 0xFFu) << 56;
+    if (translucent)
+        key |= (1ull << 55) | ((0xFFFFFFu - d) << 31) | (s << 19) | (t << 3);
+    else
+        key |= (s << 43) | (t << 27) | (d << 3);
+    return key;
+}
+
+inline unsigned int layer(uint64_t key) { return static_cast<unsigned int>(key >> 56); }
+inline bool translucent(uint64_t key) { return ((key >> 55) & 1u) != 0; }
+
+}
+
+// Key plus payload index, the unit the radix sort moves around
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Stable LSD radix sort on the full 64-bit key, 8 bits per pass. Passes
+// where every key has the same digit are skipped. Returns the number of
+// passes that actually moved data.
+unsigned int radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+struct RenderCommand;
+
+// Hook run after the command's state is bound and right before its draw
+typedef void (*RenderPrepareFn)(const RenderCommand& command);
+
+// One draw call and the state it needs
+struct RenderCommand {
+    uint64_t key = 0;
+    unsigned int program = 0;
+    unsigned int vertexArray = 0;
+    unsigned int texture = 0;            // 0 = leave texture unit 0 alone
+    GLenum textureTarget = GL_TEXTURE_2D;
+    GLenum mode = GL_TRIANGLES;
+    GLenum indexType = 0;                // 0 = glDrawArrays
+    GLint first = 0;                     // First vertex, or byte offset into the index buffer
+    GLint baseVertex = 0;                // Indexed draws only
+    GLsizei count = 0;
+    GLsizei instanceCount = 0;           // 0 = not instanced
+    RenderPrepareFn prepare = nullptr;
+    void* userData = nullptr;            // For prepare
+    uintptr_t userValue = 0;             // For prepare
+};
+
+// Per-frame counters
+struct RenderQueueStats {
+    unsigned int commands = 0;
+    unsigned int buckets = 0;    // Threads that submitted this frame
+    unsigned int sortPasses = 0; // Radix passes that were not skipped
+};
+
+// Collects draw commands from any number of threads and executes them on the
+// render thread in key order, so submission order does not matter. Each
+// submitting thread appends to its own bucket without locking after the
+// first submit of the frame.
+class RenderQueue {
+public:
+    RenderQueue();
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // Drop the previous frame's commands. Not thread safe with submit().
+    void clear();
+
+    // Thread safe; may be called concurrently from gameplay threads
+    void submit(const RenderCommand& command);
+
+    // Merge all buckets and radix sort them. Call once all submitters are done.
+    void sort();
+
+    // Issue the sorted commands on the thread that owns the GL context
+    void execute();
+
+    // Apply a single command's state and draw it immediately
+    static void execute(const RenderCommand& command);
+
+    const RenderQueueStats& stats() const { return frameStats; }
+
+private:
+    struct Bucket {
+        std::vector<RenderCommand> commands;
+    };
+
+    Bucket& localBucket();
+
+    uint64_t serial;  // Distinguishes queues in the per-thread bucket cache
+    std::mutex bucketsMutex;
+    std::vector<std::unique_ptr<Bucket>> buckets;
+    std::unordered_map<std::thread::id, Bucket*> bucketByThread;
+
+    std::vector<const RenderCommand*> commandRefs;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    RenderQueueStats frameStats;
+};
+
+#endif
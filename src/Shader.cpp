@@ -1,74 +1,412 @@
 #include "Shader.h"
+#include "GLStateCache.h"
+#include "ProgramBinaryCache.h"
+#include "GLExtensions.h"
+#include "ShaderPreprocessor.h"
+#include "AssetPack.h"
+#ifdef GAMEENGINE_EMBED_SHADERS
+#include "EmbeddedShaders.h"
+#endif
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
+namespace {
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+const GLenum COMPLETION_STATUS = 0x91B1;
+
+bool hasParallelCompile() {
+    static const bool supported = GLExtensions::has("GL_KHR_parallel_shader_compile")
+                               || GLExtensions::has("GL_ARB_parallel_shader_compile");
+    return supported;
+}
+
+#ifdef GAMEENGINE_DEVELOPMENT
+// The setter type that uploads a reflected type; see Shader::upload
+GLenum uploadType(GLenum type) {
+    switch (type) {
+    case GL_FLOAT:
+    case GL_FLOAT_VEC2:
+    case GL_FLOAT_VEC3:
+    case GL_FLOAT_VEC4:
+    case GL_FLOAT_MAT4:
+        return type;
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+        return GL_INT;
+    default:
+        return 0; // No setter for it (vectors of ints, other matrices, ...)
+    }
+}
+
+const char* typeName(GLenum type) {
+    switch (type) {
+    case GL_FLOAT:      return "float";
+    case GL_FLOAT_VEC2: return "vec2";
+    case GL_FLOAT_VEC3: return "vec3";
+    case GL_FLOAT_VEC4: return "vec4";
+    case GL_FLOAT_MAT4: return "mat4";
+    case GL_INT:        return "int";
+    case GL_BOOL:       return "bool";
+    default:            return uploadType(type) == GL_INT ? "sampler" : "unsupported type";
+    }
+}
+#endif
+
+}
+
 // Constructor: Loads, compiles, and links shaders
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, bool deferred,
+               const std::vector<std::string>& defines)
+    : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines) {
     // Load shader source from files
-    std::string vertexCode = loadShaderSource(vertexPath);
-    std::string fragmentCode = loadShaderSource(fragmentPath);
+    std::string vertexCode = preprocess(vertexPath, false);
+    std::string fragmentCode = preprocess(fragmentPath, false);
+
+    beginBuild(vertexCode, fragmentCode);
+    if (!deferred)
+        finishBuild();
+}
+
+Shader::~Shader() {
+    discardBuild();
+    if (ID)
+        GLStateCache::instance().deleteProgram(ID);
+}
+
+bool Shader::reload() {
+    if (pending)
+        return false;
+    // Always go to disk: the point of a reload is to pick up edited files.
+    // Includes may have changed too, so collect them again.
+    dependencies.clear();
+    std::string vertexCode = preprocess(vertexPath, true);
+    std::string fragmentCode = preprocess(fragmentPath, true);
+    beginBuild(vertexCode, fragmentCode);
+    return true;
+}
+
+bool Shader::usesFile(const std::string& path) const {
+    std::error_code error;
+    if (std::filesystem::equivalent(path, vertexPath, error)
+        || std::filesystem::equivalent(path, fragmentPath, error))
+        return true;
+    for (const std::string& dependency : dependencies) {
+        if (std::filesystem::equivalent(path, dependency, error))
+            return true;
+    }
+    return false;
+}
+
+std::string Shader::preprocess(const std::string& filepath, bool fromDisk) {
+    ShaderPreprocessor::FileLoader loader = fromDisk ? &Shader::readShaderFile : &Shader::loadShaderSource;
+
+    std::string source;
+    if (!loader(filepath, source)) {
+        std::cerr << "ERROR::SHADER::FILE_NOT_FOUND\n" << filepath << std::endl;
+        return std::string();
+    }
+
+    std::string output;
+    ShaderPreprocessor preprocessor(loader);
+    if (!preprocessor.process(source, filepath, defines, output, dependencies))
+        return std::string();
+    return output;
+}
+
+void Shader::beginBuild(const std::string& vertexCode, const std::string& fragmentCode) {
+    buildID = glCreateProgram();
+    pending = true;
+
+    // A cached binary skips compilation entirely
+    ProgramBinaryCache& cache = ProgramBinaryCache::instance();
+    cacheKey = cache.enabled() ? cache.key(vertexCode, fragmentCode) : 0;
+    if (cache.load(cacheKey, buildID)) {
+        pending = false;
+        adoptBuild();
+        return;
+    }
 
-    // Compile shaders
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    // Compile shaders; errors are checked in finishBuild() so the driver can
+    // work on several programs at once
+    vertexShader = glCreateShader(GL_VERTEX_SHADER);
     const char* vShaderCode = vertexCode.c_str();
     glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
     glCompileShader(vertexShader);
-    checkCompileErrors(vertexShader, "VERTEX");
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     const char* fShaderCode = fragmentCode.c_str();
     glShaderSource(fragmentShader, 1, &fShaderCode, nullptr);
     glCompileShader(fragmentShader);
-    checkCompileErrors(fragmentShader, "FRAGMENT");
 
-    // Create shader program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertexShader);
-    glAttachShader(ID, fragmentShader);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    // Link shader program
+    glAttachShader(buildID, vertexShader);
+    glAttachShader(buildID, fragmentShader);
+    if (cache.enabled())
+        glProgramParameteri(buildID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(buildID);
+}
+
+bool Shader::isReady() const {
+    if (!pending || !hasParallelCompile())
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(buildID, COMPLETION_STATUS, &done);
+    return done == GL_TRUE;
+}
+
+bool Shader::finishBuild() {
+    if (!pending)
+        return linked;
+    pending = false;
+
+    // Only look at the stage logs when linking failed, each query is a sync point
+    bool success = checkCompileErrors(buildID, "PROGRAM");
+    if (!success) {
+        checkCompileErrors(vertexShader, "VERTEX");
+        checkCompileErrors(fragmentShader, "FRAGMENT");
+    }
 
     // Cleanup shaders (not needed after linking)
+    glDetachShader(buildID, vertexShader);
+    glDetachShader(buildID, fragmentShader);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    vertexShader = fragmentShader = 0;
+
+    if (success) {
+        ProgramBinaryCache::instance().store(cacheKey, buildID);
+        adoptBuild();
+    } else if (ID == 0) {
+        // First build: keep the broken program so ID is still a valid name
+        ID = buildID;
+        buildID = 0;
+        linked = false;
+    } else {
+        // Failed reload: keep running with the previous program
+        glDeleteProgram(buildID);
+        buildID = 0;
+    }
+    return success;
+}
+
+// Swap the freshly linked program in, carrying uniform values over
+void Shader::adoptBuild() {
+    std::vector<Uniform> previous;
+    previous.swap(uniforms);
+
+    if (ID)
+        GLStateCache::instance().deleteProgram(ID);
+    ID = buildID;
+    buildID = 0;
+    linked = true;
+    reflectUniforms();
+
+    for (const Uniform& old : previous) {
+        if (!old.hasValue)
+            continue;
+        int index = findUniform(old.hash);
+        if (index < 0 || uniforms[index].type != old.type)
+            continue;
+        Uniform& uniform = uniforms[index];
+        std::memcpy(uniform.value, old.value, sizeof(old.value));
+        uniform.hasValue = true;
+        upload(uniform);
+    }
+}
+
+void Shader::discardBuild() {
+    if (vertexShader)
+        glDeleteShader(vertexShader);
+    if (fragmentShader)
+        glDeleteShader(fragmentShader);
+    if (buildID)
+        glDeleteProgram(buildID);
+    vertexShader = fragmentShader = buildID = 0;
+    pending = false;
 }
 
 // Activate the shader program
 void Shader::use() const {
-    glUseProgram(ID);
+    GLStateCache::instance().useProgram(ID);
 }
-/*
-// Set an integer uniform
-void Shader::setUniform1i(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+int Shader::findUniform(uint32_t hash) const {
+    if (uniformTable.empty())
+        return -1;
+    size_t mask = uniformTable.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        int index = uniformTable[slot];
+        if (index < 0 || uniforms[index].hash == hash)
+            return index;
+    }
+}
+
+Shader::Uniform* Shader::changed(int index, GLenum setterType, const void* value, size_t size) {
+    if (index < 0 || index >= static_cast<int>(uniforms.size()))
+        return nullptr;
+    Uniform& uniform = uniforms[index];
+#ifdef GAMEENGINE_DEVELOPMENT
+    if (uploadType(uniform.type) != setterType) {
+        // Once per uniform, as setters usually run every frame
+        if (!uniform.typeReported) {
+            std::cerr << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH\n" << uniform.name << " is a "
+                      << typeName(uniform.type) << ", set as a " << typeName(setterType) << std::endl;
+            uniform.typeReported = true;
+        }
+        return nullptr;
+    }
+#endif
+    if (uniform.hasValue && std::memcmp(uniform.value, value, size) == 0)
+        return nullptr;
+    std::memcpy(uniform.value, value, size);
+    uniform.hasValue = true;
+    return &uniform;
+}
+
+// Set an integer (or sampler) uniform
+void Shader::setUniform1i(int index, int value) {
+    if (Uniform* uniform = changed(index, GL_INT, &value, sizeof(value)))
+        upload(*uniform);
 }
 
 // Set a float uniform
-void Shader::setUniform1f(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setUniform1f(int index, float value) {
+    if (Uniform* uniform = changed(index, GL_FLOAT, &value, sizeof(value)))
+        upload(*uniform);
+}
+
+// Set a vec2 uniform
+void Shader::setUniform2f(int index, float v1, float v2) {
+    const float value[2] = { v1, v2 };
+    if (Uniform* uniform = changed(index, GL_FLOAT_VEC2, value, sizeof(value)))
+        upload(*uniform);
 }
 
 // Set a vec3 uniform
-void Shader::setUniform3f(const std::string& name, float v1, float v2, float v3) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), v1, v2, v3);
+void Shader::setUniform3f(int index, float v1, float v2, float v3) {
+    const float value[3] = { v1, v2, v3 };
+    if (Uniform* uniform = changed(index, GL_FLOAT_VEC3, value, sizeof(value)))
+        upload(*uniform);
+}
+
+// Set a vec4 uniform
+void Shader::setUniform4f(int index, float v1, float v2, float v3, float v4) {
+    const float value[4] = { v1, v2, v3, v4 };
+    if (Uniform* uniform = changed(index, GL_FLOAT_VEC4, value, sizeof(value)))
+        upload(*uniform);
 }
 
 // Set a 4x4 matrix uniform
-void Shader::setUniformMatrix4fv(const std::string& name, const float* matrix) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+void Shader::setUniformMatrix4fv(int index, const float* matrix) {
+    if (Uniform* uniform = changed(index, GL_FLOAT_MAT4, matrix, 16 * sizeof(float)))
+        upload(*uniform);
 }
-*/
+
+// Send the shadow copy of a uniform to the program, by its reflected type
+void Shader::upload(const Uniform& uniform) {
+    const float* f = reinterpret_cast<const float*>(uniform.value);
+    switch (uniform.type) {
+    case GL_FLOAT:      glProgramUniform1fv(ID, uniform.location, 1, f); break;
+    case GL_FLOAT_VEC2: glProgramUniform2fv(ID, uniform.location, 1, f); break;
+    case GL_FLOAT_VEC3: glProgramUniform3fv(ID, uniform.location, 1, f); break;
+    case GL_FLOAT_VEC4: glProgramUniform4fv(ID, uniform.location, 1, f); break;
+    case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(ID, uniform.location, 1, GL_FALSE, f); break;
+    default:
+        // int, bool and sampler uniforms
+        glProgramUniform1iv(ID, uniform.location, 1, reinterpret_cast<const GLint*>(uniform.value));
+        break;
+    }
+}
+
+// Build the uniform table once, so setting a uniform never calls glGetUniformLocation
+void Shader::reflectUniforms() {
+    uniforms.clear();
+    uniformTable.clear();
+
+    int count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(maxLength > 0 ? maxLength : 1);
+
+    for (int i = 0; i < count; ++i) {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, static_cast<GLsizei>(name.size()), nullptr, &size, &type, name.data());
+        GLint location = glGetUniformLocation(ID, name.data());
+        if (location < 0)
+            continue; // Member of a uniform block
+
+        // Arrays are reported as "name[0]"; register them under the base name
+        if (char* bracket = std::strchr(name.data(), '['))
+            *bracket = '\0';
+
+        Uniform uniform;
+        uniform.hash = fnv1a32(name.data());
+        uniform.location = location;
+        uniform.type = type;
+#ifdef GAMEENGINE_DEVELOPMENT
+        uniform.name = name.data();
+#endif
+        uniforms.push_back(uniform);
+    }
+
+    // Power-of-two table at most half full
+    size_t tableSize = 4;
+    while (tableSize < uniforms.size() * 2)
+        tableSize *= 2;
+    uniformTable.assign(tableSize, -1);
+
+    size_t mask = tableSize - 1;
+    for (size_t i = 0; i < uniforms.size(); ++i) {
+        size_t slot = uniforms[i].hash & mask;
+        while (uniformTable[slot] >= 0) {
+            if (uniforms[uniformTable[slot]].hash == uniforms[i].hash)
+                std::cerr << "ERROR::SHADER::UNIFORM_HASH_COLLISION\n" << uniforms[i].hash << std::endl;
+            slot = (slot + 1) & mask;
+        }
+        uniformTable[slot] = static_cast<int>(i);
+    }
+}
+
+// Load shader source, from the asset pack or the executable when possible
+bool Shader::loadShaderSource(const std::string& filepath, std::string& source) {
+    std::string name = std::filesystem::path(filepath).filename().string();
+    AssetView view;
+    if (AssetPack::instance().find(name, view) && view.type == AssetPackFormat::ASSET_SHADER) {
+        source.assign(static_cast<const char*>(view.data), view.size);
+        return true;
+    }
+#ifdef GAMEENGINE_EMBED_SHADERS
+    if (const EmbeddedShader* embedded = findEmbeddedShader(name)) {
+        source.assign(embedded->data, embedded->size);
+        return true;
+    }
+#endif
+    return readShaderFile(filepath, source);
+}
+
 // Load shader source from a file
-std::string Shader::loadShaderSource(const std::string& filepath) {
+bool Shader::readShaderFile(const std::string& filepath, std::string& source) {
     std::ifstream file(filepath);
+    if (!file)
+        return false;
     std::stringstream buffer;
     buffer << file.rdbuf();
-    return buffer.str();
+    source = buffer.str();
+    return true;
 }
 
-// Check for shader compilation and linking errors
-void Shader::checkCompileErrors(unsigned int shader, const std::string& type) {
+// Check for shader compilation and linking errors, returns true on success
+bool Shader::checkCompileErrors(unsigned int shader, const std::string& type) {
     int success;
     char infoLog[1024];
 
@@ -85,4 +423,5 @@ void Shader::checkCompileErrors(unsigned int shader, const std::string& type) {
             std::cerr << "ERROR::SHADER::" << type << "::COMPILATION_FAILED\n" << infoLog << std::endl;
         }
     }
+    return success != 0;
 }
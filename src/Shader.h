@@ -1,28 +1,143 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <glad/glad.h>
+#include "Hash.h"
+
+// Hashed uniform name. Use the _uniform literal or a constexpr variable so
+// the hash is computed at compile time:
+//   static constexpr UniformName COLOR("uColor");
+//   shader.setUniform4f("uColor"_uniform, 1.0f, 0.0f, 0.0f, 1.0f);
+struct UniformName {
+    uint32_t hash;
+    constexpr explicit UniformName(const char* name) : hash(fnv1a32(name)) {}
+};
+
+constexpr UniformName operator""_uniform(const char* name, size_t) {
+    return UniformName(name);
+}
 
 class Shader {
 public:
     unsigned int ID; // Shader program ID
 
-    // Constructor: loads shaders from file paths
-    Shader(const std::string& vertexPath, const std::string& fragmentPath);
+    // Constructor: loads shaders from file paths. With deferred set, the
+    // stages are compiled and linked without waiting for the driver; poll
+    // isReady() and call finishBuild() before using the program. defines
+    // ("NAME" or "NAME VALUE") select a permutation of the sources, see
+    // ShaderPreprocessor.
+    Shader(const std::string& vertexPath, const std::string& fragmentPath, bool deferred = false,
+           const std::vector<std::string>& defines = std::vector<std::string>());
+    ~Shader();
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // True once finishBuild() can run without blocking on the compiler
+    bool isReady() const;
+
+    // Check the compile and link results of a deferred build. Blocks if
+    // the driver is still compiling. Returns true if the program linked.
+    bool finishBuild();
+
+    bool isPending() const { return pending; }
+
+    // True if ID holds a successfully linked program
+    bool isLinked() const { return linked; }
+
+    // Rebuild from the original files as a deferred build. ID keeps the
+    // current program until finishBuild() links the new one; if it fails
+    // to link the old program stays. Returns false if a build is pending.
+    bool reload();
+
+    // True if path refers to one of this shader's source files or includes
+    bool usesFile(const std::string& path) const;
 
     // Use the shader program
     void use() const;
-/*
-    // Utility functions for setting uniforms
-    void setUniform1i(const std::string& name, int value) const;
-    void setUniform1f(const std::string& name, float value) const;
-    void setUniform3f(const std::string& name, float v1, float v2, float v3) const;
-    void setUniformMatrix4fv(const std::string& name, const float* matrix) const;
-*/
+
+    // Index of a reflected uniform for the setters below, or -1 if the
+    // program has no active uniform with that name. Indices change when
+    // a reload links a new program.
+    int uniformIndex(UniformName name) const { return findUniform(name.hash); }
+
+    // Utility functions for setting uniforms. Values are uploaded with
+    // glProgramUniform* (no bind needed) and skipped when unchanged.
+    void setUniform1i(UniformName name, int value) { setUniform1i(uniformIndex(name), value); }
+    void setUniform1f(UniformName name, float value) { setUniform1f(uniformIndex(name), value); }
+    void setUniform2f(UniformName name, float v1, float v2) { setUniform2f(uniformIndex(name), v1, v2); }
+    void setUniform3f(UniformName name, float v1, float v2, float v3) { setUniform3f(uniformIndex(name), v1, v2, v3); }
+    void setUniform4f(UniformName name, float v1, float v2, float v3, float v4) { setUniform4f(uniformIndex(name), v1, v2, v3, v4); }
+    void setUniformMatrix4fv(UniformName name, const float* matrix) { setUniformMatrix4fv(uniformIndex(name), matrix); }
+
+    // Same setters taking an index from uniformIndex(), skipping the lookup
+    void setUniform1i(int index, int value);
+    void setUniform1f(int index, float value);
+    void setUniform2f(int index, float v1, float v2);
+    void setUniform3f(int index, float v1, float v2, float v3);
+    void setUniform4f(int index, float v1, float v2, float v3, float v4);
+    void setUniformMatrix4fv(int index, const float* matrix);
+
 private:
-    std::string loadShaderSource(const std::string& filepath);
-    void checkCompileErrors(unsigned int shader, const std::string& type);
+    // Active uniform found at link time, with a shadow copy of its last value
+    struct Uniform {
+        uint32_t hash = 0;
+        GLint location = -1;
+        GLenum type = 0;
+        bool hasValue = false;
+        uint32_t value[16];
+#ifdef GAMEENGINE_DEVELOPMENT
+        std::string name;          // For diagnostics
+        bool typeReported = false; // A setter of the wrong type was reported
+#endif
+    };
+
+    static bool loadShaderSource(const std::string& filepath, std::string& source);
+    static bool readShaderFile(const std::string& filepath, std::string& source);
+
+    // Load a stage and expand its includes and defines. fromDisk skips the
+    // embedded copies so a reload sees edited files.
+    std::string preprocess(const std::string& filepath, bool fromDisk);
+    bool checkCompileErrors(unsigned int shader, const std::string& type);
+
+    // Compile both stages and link without querying any status
+    void beginBuild(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Probe the uniform table, -1 if not found
+    int findUniform(uint32_t hash) const;
+
+    // Make the program being built the current one
+    void adoptBuild();
+
+    // Drop an unfinished build
+    void discardBuild();
+
+    // Upload a uniform's shadow value to the current program
+    void upload(const Uniform& uniform);
+
+    // Query the active uniforms of the linked program and build the lookup table
+    void reflectUniforms();
+
+    // Returns the uniform to upload to, or nullptr if the index is invalid
+    // or the value equals the shadow copy. setterType is the GL type the
+    // setter writes (GL_INT for ints, bools and samplers); development
+    // builds report a uniform of a different type and skip it.
+    Uniform* changed(int index, GLenum setterType, const void* value, size_t size);
+
+    std::string vertexPath, fragmentPath;
+    std::vector<std::string> defines;
+    std::vector<std::string> dependencies; // Files pulled in by #include
+    unsigned int buildID = 0;                           // Program being built
+    unsigned int vertexShader = 0, fragmentShader = 0; // Stages of a pending build
+    uint64_t cacheKey = 0;
+    bool pending = false;
+    bool linked = false;
+
+    std::vector<Uniform> uniforms;   // Dense list, indexed by uniformIndex()
+    std::vector<int> uniformTable;   // Open-addressed hash -> index, -1 = empty
 };
 
 #endif
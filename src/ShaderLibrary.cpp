@@ -0,0 +1,134 @@
+#include "ShaderLibrary.h"
+#include "GLExtensions.h"
+#include <iostream>
+
+namespace {
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+}
+
+ShaderLibrary::ShaderLibrary(GLADloadproc loader) {
+    const char* setThreads = nullptr;
+    if (GLExtensions::has("GL_KHR_parallel_shader_compile"))
+        setThreads = "glMaxShaderCompilerThreadsKHR";
+    else if (GLExtensions::has("GL_ARB_parallel_shader_compile"))
+        setThreads = "glMaxShaderCompilerThreadsARB";
+    parallel = setThreads != nullptr;
+
+    // Let the driver use as many compiler threads as it wants
+    if (parallel && loader) {
+        auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(loader(setThreads));
+        if (maxThreads)
+            maxThreads(0xFFFFFFFFu);
+    }
+}
+
+Shader& ShaderLibrary::add(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+                           const std::vector<std::string>& defines) {
+    auto shader = std::make_unique<Shader>(vertexPath, fragmentPath, true, defines);
+    if (!shader->isPending())
+        finished++; // Restored from the binary cache
+
+    auto found = byName.find(name);
+    if (found != byName.end()) {
+        // Replacing a program: keep the slot, drop the old shader
+        Entry& entry = entries[found->second];
+        if (!entry.shader->isPending())
+            finished--;
+        entry.shader = std::move(shader);
+        return *entry.shader;
+    }
+
+    byName[name] = entries.size();
+    entries.push_back({ name, std::move(shader) });
+    return *entries.back().shader;
+}
+
+void ShaderLibrary::addPermutations(const std::string& name, const std::string& vertexPath,
+                                    const std::string& fragmentPath, const std::vector<std::string>& features) {
+    uint32_t count = 1u << features.size();
+    for (uint32_t permutation = 0; permutation < count; ++permutation) {
+        std::vector<std::string> defines;
+        for (size_t i = 0; i < features.size(); ++i) {
+            if (permutation & (1u << i))
+                defines.push_back(features[i]);
+        }
+        add(permutationName(name, permutation), vertexPath, fragmentPath, defines);
+    }
+}
+
+size_t ShaderLibrary::poll() {
+    size_t pending = 0;
+    bool finishedOne = false;
+    for (Entry& entry : entries) {
+        Shader& shader = *entry.shader;
+        if (!shader.isPending())
+            continue;
+
+        if (parallel ? shader.isReady() : !finishedOne) {
+            finish(entry);
+            finishedOne = true;
+        } else {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+void ShaderLibrary::finishAll() {
+    for (Entry& entry : entries) {
+        if (entry.shader->isPending())
+            finish(entry);
+    }
+}
+
+size_t ShaderLibrary::reloadFile(const std::string& path) {
+    size_t started = 0;
+    for (Entry& entry : entries) {
+        if (entry.shader->usesFile(path) && entry.shader->reload()) {
+            entry.reloading = true;
+            if (!entry.shader->isPending()) {
+                // Restored from the binary cache, nothing left to wait for
+                entry.reloading = false;
+                std::cout << "Reloaded shader " << entry.name << std::endl;
+                continue;
+            }
+            finished--;
+            started++;
+        }
+    }
+    return started;
+}
+
+void ShaderLibrary::finish(Entry& entry) {
+    bool linked = entry.shader->finishBuild();
+    finished++;
+    if (entry.reloading) {
+        entry.reloading = false;
+        if (linked)
+            std::cout << "Reloaded shader " << entry.name << std::endl;
+        else
+            std::cerr << "ERROR::SHADER_LIBRARY::RELOAD_FAILED\n" << entry.name << " (keeping previous version)" << std::endl;
+    }
+}
+
+float ShaderLibrary::progress() const {
+    return entries.empty() ? 1.0f : static_cast<float>(finished) / static_cast<float>(entries.size());
+}
+
+Shader* ShaderLibrary::get(const std::string& name) const {
+    auto found = byName.find(name);
+    if (found == byName.end())
+        return nullptr;
+    Shader* shader = entries[found->second].shader.get();
+    return shader->isLinked() ? shader : nullptr;
+}
+
+Shader* ShaderLibrary::get(const std::string& name, uint32_t permutation) const {
+    return get(permutationName(name, permutation));
+}
+
+std::string ShaderLibrary::permutationName(const std::string& name, uint32_t permutation) {
+    return name + "#" + std::to_string(permutation);
+}
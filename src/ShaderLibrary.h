@@ -0,0 +1,74 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include "Shader.h"
+
+// Owns the engine's shader programs and builds them asynchronously: every
+// program is handed to the driver up front and its status is only queried
+// once the driver reports it done (GL_KHR_parallel_shader_compile), so
+// startup costs roughly the slowest program instead of the sum.
+class ShaderLibrary {
+public:
+    // loader resolves glMaxShaderCompilerThreadsKHR when the extension exists
+    explicit ShaderLibrary(GLADloadproc loader = nullptr);
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    // Start building a program from file paths; returns without waiting
+    Shader& add(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+                const std::vector<std::string>& defines = std::vector<std::string>());
+
+    // Start building every permutation of a program up front. Bit i of a
+    // permutation key enables features[i] as a #define, so n features give
+    // 2^n programs; fetch one with get(name, key).
+    void addPermutations(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+                         const std::vector<std::string>& features);
+
+    // Finish programs the driver is done with and return how many are still
+    // pending. Without the extension the status query blocks, so at most
+    // one program is finished per call to keep a loading screen responsive.
+    size_t poll();
+
+    // Start a deferred rebuild of every program that uses the given file.
+    // Programs keep their current version until the new one links, and keep
+    // it for good if the new one fails. Returns the number of rebuilds started.
+    size_t reloadFile(const std::string& path);
+
+    // Block until every program is finished
+    void finishAll();
+
+    // Fraction of programs finished, for a loading screen
+    float progress() const;
+
+    // The named program once it has linked successfully, otherwise nullptr
+    Shader* get(const std::string& name) const;
+
+    // One permutation of a program added with addPermutations()
+    Shader* get(const std::string& name, uint32_t permutation) const;
+
+    bool parallelCompile() const { return parallel; }
+
+private:
+    struct Entry {
+        std::string name;
+        std::unique_ptr<Shader> shader;
+        bool reloading = false;
+    };
+
+    void finish(Entry& entry);
+
+    static std::string permutationName(const std::string& name, uint32_t permutation);
+
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, size_t> byName;
+    size_t finished = 0;
+    bool parallel = false;
+};
+
+#endif
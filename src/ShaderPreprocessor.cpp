@@ -0,0 +1,106 @@
+#include "ShaderPreprocessor.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Returns the file named by an #include line, or an empty string if the
+// line is not an include
+std::string includedFile(const std::string& line) {
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos || line[pos] != '#')
+        return std::string();
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+        return std::string();
+
+    size_t open = line.find_first_of("\"<", pos + 7);
+    if (open == std::string::npos)
+        return std::string();
+    size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string::npos)
+        return std::string();
+    return line.substr(open + 1, close - open - 1);
+}
+
+bool isVersionLine(const std::string& line) {
+    size_t pos = line.find_first_not_of(" \t");
+    return pos != std::string::npos && line.compare(pos, 8, "#version") == 0;
+}
+
+}
+
+ShaderPreprocessor::ShaderPreprocessor(FileLoader loader) : loader(std::move(loader)) {}
+
+bool ShaderPreprocessor::process(const std::string& source, const std::string& path,
+                                 const std::vector<std::string>& defines,
+                                 std::string& output, std::vector<std::string>& dependencies) {
+    output.clear();
+    includeStack.clear();
+
+    // #version has to stay first, so the permutation defines go right after it
+    std::string defineBlock;
+    for (const std::string& define : defines)
+        defineBlock += "#define " + define + "\n";
+
+    std::string body = source;
+    int bodyLine = 1;
+    size_t lineEnd = source.find('\n');
+    std::string versionLine = source.substr(0, lineEnd);
+    if (isVersionLine(versionLine)) {
+        output = versionLine + "\n" + defineBlock;
+        body = lineEnd == std::string::npos ? std::string() : source.substr(lineEnd + 1);
+        bodyLine = 2;
+        if (!defines.empty())
+            output += "#line 2\n";
+    } else {
+        output = defineBlock;
+        if (!defines.empty())
+            output += "#line 1\n";
+    }
+
+    return expand(body, path, bodyLine, output, dependencies);
+}
+
+bool ShaderPreprocessor::expand(const std::string& source, const std::string& path, int firstLine,
+                                std::string& output, std::vector<std::string>& dependencies) {
+    if (std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end()) {
+        std::cerr << "ERROR::SHADER_PREPROCESSOR::RECURSIVE_INCLUDE\n" << path << std::endl;
+        return false;
+    }
+    includeStack.push_back(path);
+
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = firstLine - 1;
+    bool ok = true;
+    while (ok && std::getline(lines, line)) {
+        lineNumber++;
+        std::string name = includedFile(line);
+        if (name.empty()) {
+            output += line;
+            output += '\n';
+            continue;
+        }
+
+        std::string includePath = (std::filesystem::path(path).parent_path() / name).generic_string();
+        std::string included;
+        if (!loader(includePath, included)) {
+            std::cerr << "ERROR::SHADER_PREPROCESSOR::INCLUDE_NOT_FOUND\n" << includePath
+                      << " (from " << path << ":" << lineNumber << ")" << std::endl;
+            ok = false;
+            break;
+        }
+        if (std::find(dependencies.begin(), dependencies.end(), includePath) == dependencies.end())
+            dependencies.push_back(includePath);
+
+        ok = expand(included, includePath, 1, output, dependencies);
+        // Keep compiler line numbers matching the including file
+        output += "#line " + std::to_string(lineNumber + 1) + "\n";
+    }
+
+    includeStack.pop_back();
+    return ok;
+}
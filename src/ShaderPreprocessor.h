@@ -0,0 +1,34 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Expands the engine's GLSL extensions before a stage is compiled:
+//   #include "file"   pasted in place, resolved relative to the including file
+//   defines           "NAME" or "NAME VALUE", emitted as #define lines right
+//                     after #version so one source yields several permutations
+class ShaderPreprocessor {
+public:
+    // Returns the source of a file, or false if it cannot be read
+    typedef std::function<bool(const std::string& path, std::string& source)> FileLoader;
+
+    explicit ShaderPreprocessor(FileLoader loader);
+
+    // Expand source (read from path) into output. Every file pulled in by
+    // #include is appended to dependencies. Returns false on a missing or
+    // recursive include.
+    bool process(const std::string& source, const std::string& path,
+                 const std::vector<std::string>& defines,
+                 std::string& output, std::vector<std::string>& dependencies);
+
+private:
+    bool expand(const std::string& source, const std::string& path, int firstLine,
+                std::string& output, std::vector<std::string>& dependencies);
+
+    FileLoader loader;
+    std::vector<std::string> includeStack; // Files being expanded, to catch cycles
+};
+
+#endif
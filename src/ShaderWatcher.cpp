@@ -0,0 +1,61 @@
+#include "ShaderWatcher.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+ShaderWatcher::ShaderWatcher(const std::string& directory) : directory(directory) {
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+        return;
+    }
+    // Editors either rewrite in place (close-write) or save to a temporary
+    // file and rename it over the original (moved-to)
+    watch = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0) {
+        std::cerr << "ERROR::SHADER_WATCHER::CANNOT_WATCH\n" << directory << std::endl;
+        close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::poll() {
+    std::vector<std::string> changed;
+#ifdef __linux__
+    if (fd < 0)
+        return changed;
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN: nothing more queued
+
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+
+            std::string path = directory + "/" + event->name;
+            if (std::find(changed.begin(), changed.end(), path) == changed.end())
+                changed.push_back(path);
+        }
+    }
+#endif
+    return changed;
+}
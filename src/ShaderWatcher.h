@@ -0,0 +1,30 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+
+// Watches a directory for modified shader files during development. Uses
+// inotify on Linux; on other platforms the watcher is inactive and poll()
+// never reports anything.
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(const std::string& directory);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    bool active() const { return fd >= 0; }
+
+    // Paths of files written since the last call, each reported once.
+    // Never blocks.
+    std::vector<std::string> poll();
+
+private:
+    std::string directory;
+    int fd = -1;
+    int watch = -1;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "SimulationPipeline.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+double now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+SimulationPipeline::SimulationPipeline(unsigned int depth, SimulateFn simulate)
+    : pipelineDepth(depth), simulate(std::move(simulate)), snapshots(depth + 1) {
+    for (int i = 0; i < static_cast<int>(snapshots.size()); ++i)
+        freeSnapshots.push_back(i);
+    if (pipelineDepth > 0)
+        worker = std::thread(&SimulationPipeline::simulationLoop, this);
+}
+
+SimulationPipeline::~SimulationPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    simulationWake.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void SimulationPipeline::post(Command command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(std::move(command));
+}
+
+// Runs on whichever thread simulates: apply posted commands, then the frame
+void SimulationPipeline::simulateInto(RenderSnapshot& snapshot) {
+    std::vector<Command> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.swap(commands);
+    }
+    for (Command& command : pending)
+        command();
+
+    snapshot.frame = nextFrame++;
+    snapshot.started = now();
+    simulate(snapshot);
+}
+
+void SimulationPipeline::simulationLoop() {
+    Profiler::instance().setThreadName("Simulation");
+    for (;;) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            double waitStart = now();
+            simulationWake.wait(lock, [this] { return stopping || !freeSnapshots.empty(); });
+            if (stopping)
+                return;
+            simulationWait += now() - waitStart;
+            index = freeSnapshots.front();
+            freeSnapshots.pop_front();
+        }
+
+        simulateInto(snapshots[index]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readySnapshots.push_back(index);
+        }
+        renderWake.notify_one();
+    }
+}
+
+const RenderSnapshot& SimulationPipeline::acquire() {
+    if (pipelineDepth == 0) {
+        current = 0;
+        simulateInto(snapshots[0]);
+        counters.renderWait = 0.0;
+        counters.simulationWait = 0.0;
+    } else {
+        PROFILE_SCOPE("Wait for simulation");
+        std::unique_lock<std::mutex> lock(mutex);
+        double waitStart = now();
+        renderWake.wait(lock, [this] { return !readySnapshots.empty(); });
+        counters.renderWait = now() - waitStart;
+        counters.simulationWait = simulationWait;
+        simulationWait = 0.0;
+        current = readySnapshots.front();
+        readySnapshots.pop_front();
+    }
+    currentStarted = snapshots[current].started;
+    return snapshots[current];
+}
+
+void SimulationPipeline::release() {
+    if (current < 0)
+        return;
+    if (pipelineDepth > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSnapshots.push_back(current);
+        }
+        simulationWake.notify_one();
+    }
+    current = -1;
+}
+
+void SimulationPipeline::presented() {
+    counters.latency = now() - currentStarted;
+    counters.maxLatency = std::max(counters.maxLatency, counters.latency);
+}
@@ -0,0 +1,93 @@
+#ifndef SIMULATION_PIPELINE_H
+#define SIMULATION_PIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FixedTimestep.h"
+#include "SpriteRenderer.h"
+
+// Everything the render stage needs to draw one frame, written by the
+// simulation stage. Nothing in here is shared with the simulation state,
+// so the two stages never touch the same memory.
+struct RenderSnapshot {
+    uint64_t frame = 0;
+    double started = 0.0;     // Seconds (steady clock) when simulating this frame began
+    unsigned int steps = 0;   // Fixed steps simulated for this frame
+    FixedTimestepStats timestep; // Totals after this frame, for reporting
+    std::vector<Sprite> sprites; // Interpolated, ready to draw
+};
+
+struct SimulationPipelineStats {
+    double latency = 0.0;        // Seconds from simulation start to present, last frame
+    double maxLatency = 0.0;
+    double renderWait = 0.0;     // Seconds the render thread waited for a snapshot, last frame
+    double simulationWait = 0.0; // Seconds the simulation waited for a free snapshot, last frame
+};
+
+// Two-stage frame pipeline. A worker thread simulates frame N+1 (up to
+// depth frames ahead) while the GL thread submits frame N from a
+// snapshot, so simulation and submission overlap instead of adding up.
+// Snapshots are recycled through depth + 1 buffers; a deeper pipeline
+// absorbs uneven stage times at the cost of latency.
+//
+// Per frame on the GL thread:
+//   acquire() ... draw from the snapshot ... release(); swap; presented()
+class SimulationPipeline {
+public:
+    // Runs on the simulation thread: advance the game and fill the snapshot
+    typedef std::function<void(RenderSnapshot& snapshot)> SimulateFn;
+    typedef std::function<void()> Command;
+
+    // depth 0 simulates on the calling thread inside acquire(), i.e. the
+    // stages run back to back, for comparison
+    SimulationPipeline(unsigned int depth, SimulateFn simulate);
+    ~SimulationPipeline();
+
+    SimulationPipeline(const SimulationPipeline&) = delete;
+    SimulationPipeline& operator=(const SimulationPipeline&) = delete;
+
+    // Run a command on the simulation thread before it starts its next
+    // frame. The way for the GL thread to change simulation state.
+    void post(Command command);
+
+    // Wait for the oldest simulated frame and hand it to the render stage
+    const RenderSnapshot& acquire();
+
+    // Give the acquired snapshot back once nothing reads it any more
+    void release();
+
+    // Call once the acquired frame is presented, to measure its latency
+    void presented();
+
+    unsigned int depth() const { return pipelineDepth; }
+    const SimulationPipelineStats& stats() const { return counters; }
+
+private:
+    void simulateInto(RenderSnapshot& snapshot);
+    void simulationLoop();
+
+    unsigned int pipelineDepth;
+    SimulateFn simulate;
+    std::vector<RenderSnapshot> snapshots;
+    int current = -1;           // Snapshot held by the render stage
+    double currentStarted = 0.0;
+    uint64_t nextFrame = 1;     // Simulation stage only
+
+    std::mutex mutex; // Guards the lists, commands and stopping
+    std::condition_variable simulationWake, renderWake;
+    std::deque<int> freeSnapshots;
+    std::deque<int> readySnapshots;
+    std::vector<Command> commands;
+    double simulationWait = 0.0; // Accumulated by the simulation thread, taken by acquire()
+    bool stopping = false;
+    std::thread worker;
+
+    SimulationPipelineStats counters;
+};
+
+#endif
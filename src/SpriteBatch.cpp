@@ -0,0 +1,167 @@
+#include "SpriteBatch.h"
+#include "Shader.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Constructor: creates the streaming vertex buffer and the static quad index buffer
+SpriteBatch::SpriteBatch(unsigned int maxQuadsPerFlush)
+    : maxQuads(std::min(std::max(maxQuadsPerFlush, 1u), 16384u)),
+      vertexStream(GL_ARRAY_BUFFER, 4 * 1024 * 1024) {
+    // Every quad uses the same two-triangle pattern, so the indices never change
+    std::vector<unsigned short> indices(maxQuads * 6);
+    for (unsigned int i = 0; i < maxQuads; ++i) {
+        unsigned short base = static_cast<unsigned short>(i * 4);
+        indices[i * 6 + 0] = base + 0;
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 2;
+        indices[i * 6 + 3] = base + 2;
+        indices[i * 6 + 4] = base + 3;
+        indices[i * 6 + 5] = base + 0;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &EBO);
+
+    GLStateCache& state = GLStateCache::instance();
+    state.bindVertexArray(VAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, vertexStream.ID);
+
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+
+    VertexLayout layout;
+    layout.add(0, VertexFormat::Float2)
+          .add(1, VertexFormat::Half2)
+          .add(2, VertexFormat::UByte4Norm)
+          .add(3, VertexFormat::UShort2);
+    static_assert(sizeof(Vertex) == 20, "Vertex must match the sprite vertex layout");
+    layout.enable();
+    layout.apply();
+
+    state.bindVertexArray(0); // Unbind VAO (keeps the EBO binding)
+}
+
+SpriteBatch::~SpriteBatch() {
+    GLStateCache::instance().deleteVertexArray(VAO);
+    GLStateCache::instance().deleteBuffer(EBO);
+}
+
+void SpriteBatch::begin() {
+    // Last frame's draws have been issued by now, so its vertices can be fenced
+    vertexStream.endFrame();
+
+    sprites.clear();
+    entries.clear();
+    frameStats = SpriteBatchStats();
+}
+
+void SpriteBatch::draw(const Sprite& sprite, const Shader& shader) {
+    uint64_t key = (static_cast<uint64_t>(shader.ID) << 32) | sprite.texture;
+    entries.push_back({ key, static_cast<uint32_t>(sprites.size()) });
+    sprites.push_back(sprite);
+    frameStats.sprites++;
+}
+
+void SpriteBatch::end() {
+    flush(nullptr, 0);
+}
+
+void SpriteBatch::end(RenderQueue& queue, unsigned int layer) {
+    flush(&queue, layer);
+}
+
+void SpriteBatch::flush(RenderQueue* queue, unsigned int layer) {
+    if (entries.empty())
+        return;
+
+    // Group identical state together; the radix sort is stable so submission
+    // order is kept inside a run
+    radixSort(entries, scratch);
+
+    // Expand the whole frame with a single mapping, so deferred draws never
+    // see the storage orphaned underneath them
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(entries.size() * 4 * sizeof(Vertex));
+    GLintptr offset = 0;
+    uint64_t stallsBefore = vertexStream.stats().stalls;
+    Vertex* out = static_cast<Vertex*>(vertexStream.map(bytes, sizeof(Vertex), offset));
+    frameStats.stalls += static_cast<unsigned int>(vertexStream.stats().stalls - stallsBefore);
+    if (!out)
+        return;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+        writeQuad(&out[i * 4], sprites[entries[i].index]);
+    vertexStream.unmap();
+
+    frameStats.flushes++;
+    frameStats.bytesUploaded += static_cast<unsigned int>(bytes);
+    GLint baseVertex = static_cast<GLint>(offset / sizeof(Vertex));
+
+    size_t runStart = 0;
+    while (runStart < entries.size()) {
+        uint64_t key = entries[runStart].key;
+        size_t runEnd = runStart + 1;
+        bool translucent = sprites[entries[runStart].index].a < 1.0f;
+        while (runEnd < entries.size() && entries[runEnd].key == key) {
+            translucent = translucent || sprites[entries[runEnd].index].a < 1.0f;
+            ++runEnd;
+        }
+
+        RenderCommand command;
+        command.program = static_cast<unsigned int>(key >> 32);
+        command.texture = static_cast<unsigned int>(key & 0xFFFFFFFFu);
+        command.key = RenderKey::make(layer, translucent, command.program, command.texture, 0.0f);
+        command.textureTarget = GL_TEXTURE_2D_ARRAY;
+        command.vertexArray = VAO;
+        command.indexType = GL_UNSIGNED_SHORT;
+
+        // The 16-bit index buffer covers maxQuads quads, so long runs are split
+        for (size_t first = runStart; first < runEnd; first += maxQuads) {
+            size_t quads = std::min<size_t>(maxQuads, runEnd - first);
+            command.count = static_cast<GLsizei>(quads * 6);
+            command.baseVertex = baseVertex + static_cast<GLint>(first * 4);
+            if (queue)
+                queue->submit(command);
+            else
+                RenderQueue::execute(command);
+            frameStats.drawCalls++;
+        }
+        runStart = runEnd;
+    }
+}
+
+// Write the four corners of a sprite (counter-clockwise from bottom-left)
+void SpriteBatch::writeQuad(Vertex* out, const Sprite& sprite) {
+    float hw = sprite.width * 0.5f;
+    float hh = sprite.height * 0.5f;
+    float c = 1.0f, s = 0.0f;
+    if (sprite.rotation != 0.0f) {
+        c = std::cos(sprite.rotation);
+        s = std::sin(sprite.rotation);
+    }
+
+    const float cornersX[4] = { -hw,  hw, hw, -hw };
+    const float cornersY[4] = { -hh, -hh, hh,  hh };
+    // Convert once per sprite, not per corner
+    uint16_t u0 = packHalf(sprite.u0), u1 = packHalf(sprite.u1);
+    uint16_t v0 = packHalf(sprite.v0), v1 = packHalf(sprite.v1);
+    const uint16_t us[4] = { u0, u1, u1, u0 };
+    const uint16_t vs[4] = { v0, v0, v1, v1 };
+    uint8_t r = packUnorm8(sprite.r), g = packUnorm8(sprite.g);
+    uint8_t b = packUnorm8(sprite.b), a = packUnorm8(sprite.a);
+
+    for (int i = 0; i < 4; ++i) {
+        out[i].x = sprite.x + cornersX[i] * c - cornersY[i] * s;
+        out[i].y = sprite.y + cornersX[i] * s + cornersY[i] * c;
+        out[i].u = us[i];
+        out[i].v = vs[i];
+        out[i].r = r;
+        out[i].g = g;
+        out[i].b = b;
+        out[i].a = a;
+        out[i].layer = sprite.layer;
+        out[i].flags = 0;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "SpriteRenderer.h"
+#include "StreamBuffer.h"
+#include "RenderQueue.h"
+#include "VertexLayout.h"
+
+// Accumulates sprites for a frame, sorts them by shader and texture and
+// draws each run of identical state with a single indexed draw call.
+class SpriteBatch : public SpriteRenderer {
+public:
+    // maxQuadsPerFlush bounds a single upload; indices are 16 bit so it
+    // cannot exceed 16384 quads (65536 vertices).
+    explicit SpriteBatch(unsigned int maxQuadsPerFlush = 16384);
+    ~SpriteBatch() override;
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    void begin() override;
+    void draw(const Sprite& sprite, const Shader& shader) override;
+    void end() override;
+    void end(RenderQueue& queue, unsigned int layer) override;
+
+    const SpriteBatchStats& stats() const override { return frameStats; }
+
+private:
+    // Interleaved vertex of the streaming buffer, 20 bytes
+    struct Vertex {
+        float x, y;            // location 0
+        uint16_t u, v;         // location 1, half floats
+        uint8_t r, g, b, a;    // location 2, normalized
+        uint16_t layer, flags; // location 3, integer
+    };
+
+    // Upload the frame and either submit its draws to queue or, without a
+    // queue, draw them immediately
+    void flush(RenderQueue* queue, unsigned int layer);
+    static void writeQuad(Vertex* out, const Sprite& sprite);
+
+    unsigned int VAO = 0, EBO = 0;
+    unsigned int maxQuads;
+    StreamBuffer vertexStream;
+
+    std::vector<Sprite> sprites;
+    std::vector<SortEntry> entries; // Key is (program << 32 | texture)
+    std::vector<SortEntry> scratch;
+    SpriteBatchStats frameStats;
+};
+
+#endif
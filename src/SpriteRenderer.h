@@ -0,0 +1,52 @@
+#ifndef SPRITE_RENDERER_H
+#define SPRITE_RENDERER_H
+
+#include <cstdint>
+
+class Shader;
+class RenderQueue;
+
+// A single rotated, tinted quad submitted to a SpriteRenderer
+struct Sprite {
+    float x = 0.0f, y = 0.0f;           // Center position
+    float width = 1.0f, height = 1.0f;  // Full extents
+    float rotation = 0.0f;              // Radians around the center
+    float u0 = 0.0f, v0 = 0.0f;         // UV rectangle
+    float u1 = 1.0f, v1 = 1.0f;
+    float r = 1.0f, g = 1.0f, b = 1.0f, a = 1.0f; // Tint
+    unsigned int texture = 0;           // GL_TEXTURE_2D_ARRAY name (a TextureAtlas), 0 = untextured
+    uint16_t layer = 0;                 // Array layer the UVs refer to
+};
+
+// Per-frame counters, reset by SpriteRenderer::begin()
+struct SpriteBatchStats {
+    unsigned int sprites = 0;       // Sprites submitted
+    unsigned int drawCalls = 0;     // Draw calls issued
+    unsigned int flushes = 0;       // Buffer uploads
+    unsigned int bytesUploaded = 0; // Vertex/instance bytes sent to the GPU
+    unsigned int stalls = 0;        // Waits on the GPU before writing the stream buffer
+};
+
+// Common interface of the sprite backends so they can be swapped and benchmarked
+class SpriteRenderer {
+public:
+    virtual ~SpriteRenderer() = default;
+
+    // Start a new frame and reset the stats
+    virtual void begin() = 0;
+
+    // Queue a sprite to be drawn with the given shader
+    virtual void draw(const Sprite& sprite, const Shader& shader) = 0;
+
+    // Sort everything queued since begin() and issue the draw calls
+    virtual void end() = 0;
+
+    // Like end(), but upload the sprites and submit the draws to a render
+    // queue on the given layer instead of drawing right away. The queue must
+    // be executed before the next begin().
+    virtual void end(RenderQueue& queue, unsigned int layer) = 0;
+
+    virtual const SpriteBatchStats& stats() const = 0;
+};
+
+#endif
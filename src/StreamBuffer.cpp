@@ -0,0 +1,110 @@
+#include "StreamBuffer.h"
+#include "GLStateCache.h"
+#include <iostream>
+
+// Constructor: allocates storage for all segments of the ring
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr segmentSize, unsigned int segmentCount)
+    : bufferTarget(target), segmentSize(segmentSize < 1 ? 1 : segmentSize), segmentCount(segmentCount < 1 ? 1 : segmentCount),
+      fences(this->segmentCount, nullptr) {
+    glGenBuffers(1, &ID);
+    GLStateCache::instance().bindBuffer(bufferTarget, ID);
+    glBufferData(bufferTarget, this->segmentSize * this->segmentCount, nullptr, GL_STREAM_DRAW);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (GLsync fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    GLStateCache::instance().deleteBuffer(ID);
+}
+
+void* StreamBuffer::map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset) {
+    if (alignment < 1)
+        alignment = 1;
+
+    GLintptr segmentBase = static_cast<GLintptr>(currentSegment) * segmentSize;
+    GLintptr absolute = (segmentBase + cursor + alignment - 1) / alignment * alignment;
+    if (absolute + size > segmentBase + segmentSize) {
+        // Out of room this frame: take fresh storage big enough for the whole frame
+        // instead of waiting on the GPU
+        orphan(absolute - segmentBase + size);
+        segmentBase = 0;
+        absolute = 0;
+    }
+
+    if (!segmentReady) {
+        waitForSegment(currentSegment);
+        segmentReady = true;
+    }
+
+    GLStateCache::instance().bindBuffer(bufferTarget, ID);
+    void* ptr = glMapBufferRange(bufferTarget, absolute, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!ptr) {
+        std::cerr << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+        return nullptr;
+    }
+
+    cursor = absolute - segmentBase + size;
+    offset = absolute;
+    counters.bytesUploaded += static_cast<uint64_t>(size);
+    return ptr;
+}
+
+void StreamBuffer::unmap() {
+    GLStateCache::instance().bindBuffer(bufferTarget, ID);
+    glUnmapBuffer(bufferTarget);
+}
+
+void StreamBuffer::endFrame() {
+    if (cursor > 0) {
+        if (fences[currentSegment])
+            glDeleteSync(fences[currentSegment]);
+        fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    currentSegment = (currentSegment + 1) % segmentCount;
+    cursor = 0;
+    segmentReady = false;
+    counters.frames++;
+}
+
+// Block until the GPU has finished reading the segment written segmentCount frames ago
+void StreamBuffer::waitForSegment(unsigned int segment) {
+    GLsync fence = fences[segment];
+    if (!fence)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        counters.stalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED)
+        std::cerr << "ERROR::STREAM_BUFFER::FENCE_WAIT_FAILED" << std::endl;
+
+    glDeleteSync(fence);
+    fences[segment] = nullptr;
+}
+
+// Re-specify the storage; the driver keeps the old block alive for pending draws
+void StreamBuffer::orphan(GLsizeiptr minSegmentSize) {
+    while (segmentSize < minSegmentSize)
+        segmentSize *= 2;
+
+    for (GLsync& fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLStateCache::instance().bindBuffer(bufferTarget, ID);
+    glBufferData(bufferTarget, segmentSize * segmentCount, nullptr, GL_STREAM_DRAW);
+
+    currentSegment = 0;
+    cursor = 0;
+    segmentReady = true; // Fresh storage has no readers
+    counters.orphans++;
+}
@@ -0,0 +1,60 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+// Cumulative counters since the buffer was created
+struct StreamBufferStats {
+    uint64_t bytesUploaded = 0; // Bytes handed out by map()
+    uint64_t stalls = 0;        // Times the CPU had to wait for the GPU on a fence
+    uint64_t orphans = 0;       // Times the storage was re-specified
+    uint64_t frames = 0;        // endFrame() calls
+};
+
+// Ring of per-frame segments inside one buffer object. Each frame writes into
+// its own segment through unsynchronized mappings; a fence placed at the end
+// of the frame guards the segment until the GPU has consumed it, so the CPU
+// only waits when it laps the GPU by a full ring.
+class StreamBuffer {
+public:
+    unsigned int ID; // Buffer object name
+
+    // segmentSize is the expected upload volume of one frame
+    StreamBuffer(GLenum target, GLsizeiptr segmentSize, unsigned int segmentCount = 3);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Map size bytes of the current segment for writing. The returned offset
+    // (in bytes from the start of the buffer) is a multiple of alignment.
+    // If the segment is full the storage is orphaned and grown as needed, so
+    // draws reading a mapped range must be issued before the next map().
+    void* map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+
+    // Unmap the range returned by the last map()
+    void unmap();
+
+    // Fence everything written this frame and move on to the next segment
+    void endFrame();
+
+    GLenum target() const { return bufferTarget; }
+    const StreamBufferStats& stats() const { return counters; }
+
+private:
+    void waitForSegment(unsigned int segment);
+    void orphan(GLsizeiptr minSegmentSize);
+
+    GLenum bufferTarget;
+    GLsizeiptr segmentSize;
+    unsigned int segmentCount;
+    unsigned int currentSegment = 0;
+    GLsizeiptr cursor = 0;           // Write position inside the current segment
+    bool segmentReady = false;       // Fence of the current segment already waited on
+    std::vector<GLsync> fences;
+    StreamBufferStats counters;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "TextureAtlas.h"
+#include "GLStateCache.h"
+#include "SpriteRenderer.h"
+#include "TextureFormat.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+bool intersects(const AtlasRect& a, const AtlasRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width
+        && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+int roundUp(int value, int multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+bool contains(const AtlasRect& outer, const AtlasRect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y
+        && inner.x + inner.width <= outer.x + outer.width
+        && inner.y + inner.height <= outer.y + outer.height;
+}
+
+}
+
+MaxRectsPacker::MaxRectsPacker(int width, int height) : width(width), height(height) {
+    reset();
+}
+
+void MaxRectsPacker::reset() {
+    usedArea = 0;
+    freeRects.clear();
+    freeRects.push_back({ 0, 0, width, height });
+}
+
+bool MaxRectsPacker::insert(int w, int h, AtlasRect& placed) {
+    // Best short side fit: the free rectangle that leaves the smallest gap on
+    // its tighter side, ties broken by the other side
+    int bestShort = INT_MAX, bestLong = INT_MAX;
+    for (const AtlasRect& free : freeRects) {
+        if (free.width < w || free.height < h)
+            continue;
+        int leftoverX = free.width - w, leftoverY = free.height - h;
+        int shortSide = std::min(leftoverX, leftoverY);
+        int longSide = std::max(leftoverX, leftoverY);
+        if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+            bestShort = shortSide;
+            bestLong = longSide;
+            placed = { free.x, free.y, w, h };
+        }
+    }
+    if (bestShort == INT_MAX)
+        return false;
+
+    splitFreeRects(placed);
+    pruneFreeRects();
+    usedArea += static_cast<long long>(w) * h;
+    return true;
+}
+
+void MaxRectsPacker::release(const AtlasRect& rect) {
+    usedArea -= static_cast<long long>(rect.width) * rect.height;
+    if (usedArea <= 0) {
+        reset();
+        return;
+    }
+    // Free rectangles are not merged, so space freed piecemeal can stay
+    // fragmented until the whole layer empties
+    freeRects.push_back(rect);
+    pruneFreeRects();
+}
+
+float MaxRectsPacker::occupancy() const {
+    return static_cast<float>(usedArea) / (static_cast<float>(width) * static_cast<float>(height));
+}
+
+// Replace every free rectangle the placement overlaps by its (up to four)
+// maximal leftovers
+void MaxRectsPacker::splitFreeRects(const AtlasRect& placed) {
+    std::vector<AtlasRect> next;
+    next.reserve(freeRects.size() + 4);
+    for (const AtlasRect& free : freeRects) {
+        if (!intersects(free, placed)) {
+            next.push_back(free);
+            continue;
+        }
+        int placedRight = placed.x + placed.width, placedTop = placed.y + placed.height;
+        int freeRight = free.x + free.width, freeTop = free.y + free.height;
+        if (placed.x > free.x)
+            next.push_back({ free.x, free.y, placed.x - free.x, free.height });
+        if (placedRight < freeRight)
+            next.push_back({ placedRight, free.y, freeRight - placedRight, free.height });
+        if (placed.y > free.y)
+            next.push_back({ free.x, free.y, free.width, placed.y - free.y });
+        if (placedTop < freeTop)
+            next.push_back({ free.x, placedTop, free.width, freeTop - placedTop });
+    }
+    freeRects.swap(next);
+}
+
+// Drop free rectangles contained in another one
+void MaxRectsPacker::pruneFreeRects() {
+    for (size_t i = 0; i < freeRects.size(); ++i) {
+        for (size_t j = i + 1; j < freeRects.size(); ++j) {
+            if (contains(freeRects[j], freeRects[i])) {
+                freeRects.erase(freeRects.begin() + i);
+                --i;
+                break;
+            }
+            if (contains(freeRects[i], freeRects[j])) {
+                freeRects.erase(freeRects.begin() + j);
+                --j;
+            }
+        }
+    }
+}
+
+// Constructor: allocates every layer of the array texture
+TextureAtlas::TextureAtlas(int size, int layerCount, int padding, uint32_t format)
+    : ID(0), imageFormat(format) {
+    // With every size and position a multiple of the block, all the packer's
+    // placements land on the block grid
+    int block = TextureFormat::blockSize(format);
+    layerSize = roundUp(size, block);
+    this->padding = roundUp(padding, block);
+    layers.assign(layerCount, MaxRectsPacker(layerSize, layerSize));
+    layerImages.assign(layerCount, 0);
+
+    GLStateCache& state = GLStateCache::instance();
+    glGenTextures(1, &ID);
+    state.bindTexture(0, GL_TEXTURE_2D_ARRAY, ID);
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLenum internalFormat = TextureFormat::internalFormat(format);
+    if (TextureFormat::isCompressed(format)) {
+        GLsizei bytes = static_cast<GLsizei>(TextureFormat::imageSize(format, layerSize, layerSize) * layerCount);
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, layerSize, layerSize, layerCount, 0, bytes, nullptr);
+    } else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, layerSize, layerSize, layerCount, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+TextureAtlas::~TextureAtlas() {
+    GLStateCache::instance().deleteTexture(ID);
+}
+
+uint32_t TextureAtlas::insert(const void* pixels, int width, int height) {
+    uint32_t handle = allocate(width, height);
+    if (handle) {
+        GLStateCache::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        upload(handle, pixels);
+    }
+    return handle;
+}
+
+uint32_t TextureAtlas::allocate(int width, int height) {
+    int block = TextureFormat::blockSize(imageFormat);
+    int blockWidth = roundUp(width, block), blockHeight = roundUp(height, block);
+
+    // Fill layers in order so later layers stay free for large images
+    AtlasRect padded;
+    size_t layer = 0;
+    for (; layer < layers.size(); ++layer) {
+        if (layers[layer].insert(blockWidth + 2 * padding, blockHeight + 2 * padding, padded))
+            break;
+    }
+    if (layer == layers.size()) {
+        failedInserts++;
+        return 0;
+    }
+    layerImages[layer]++;
+
+    AtlasRegion region;
+    region.layer = static_cast<unsigned int>(layer);
+    region.rect = { padded.x + padding, padded.y + padding, blockWidth, blockHeight };
+    float scale = 1.0f / static_cast<float>(layerSize);
+    region.u0 = region.rect.x * scale;
+    region.v0 = region.rect.y * scale;
+    region.u1 = (region.rect.x + width) * scale;
+    region.v1 = (region.rect.y + height) * scale;
+
+    uint32_t handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        entries.emplace_back();
+        handle = static_cast<uint32_t>(entries.size());
+    }
+    entries[handle - 1].region = region;
+    entries[handle - 1].live = true;
+    return handle;
+}
+
+void TextureAtlas::upload(uint32_t handle, const void* pixels) {
+    const AtlasRegion* found = region(handle);
+    if (!found)
+        return;
+    const AtlasRect& rect = found->rect;
+    GLStateCache::instance().bindTexture(0, GL_TEXTURE_2D_ARRAY, ID);
+    if (TextureFormat::isCompressed(imageFormat)) {
+        GLsizei bytes = static_cast<GLsizei>(TextureFormat::imageSize(imageFormat, rect.width, rect.height));
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.x, rect.y, static_cast<GLint>(found->layer),
+                                  rect.width, rect.height, 1, TextureFormat::internalFormat(imageFormat), bytes, pixels);
+    } else {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.x, rect.y, static_cast<GLint>(found->layer),
+                        rect.width, rect.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+}
+
+void TextureAtlas::evict(uint32_t handle) {
+    if (!region(handle))
+        return;
+    Entry& entry = entries[handle - 1];
+    const AtlasRect& rect = entry.region.rect;
+    AtlasRect padded = { rect.x - padding, rect.y - padding, rect.width + 2 * padding, rect.height + 2 * padding };
+    layers[entry.region.layer].release(padded);
+    layerImages[entry.region.layer]--;
+    entry.live = false;
+    freeHandles.push_back(handle);
+}
+
+const AtlasRegion* TextureAtlas::region(uint32_t handle) const {
+    if (handle == 0 || handle > entries.size() || !entries[handle - 1].live)
+        return nullptr;
+    return &entries[handle - 1].region;
+}
+
+void TextureAtlas::apply(uint32_t handle, Sprite& sprite) const {
+    const AtlasRegion* found = region(handle);
+    if (!found)
+        return;
+    sprite.texture = ID;
+    sprite.layer = static_cast<uint16_t>(found->layer);
+    sprite.u0 = found->u0;
+    sprite.v0 = found->v0;
+    sprite.u1 = found->u1;
+    sprite.v1 = found->v1;
+}
+
+TextureAtlasStats TextureAtlas::stats() const {
+    TextureAtlasStats result;
+    result.images = static_cast<unsigned int>(entries.size() - freeHandles.size());
+    result.failedInserts = failedInserts;
+    float occupied = 0.0f;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (layerImages[i] > 0)
+            result.layersUsed++;
+        occupied += layers[i].occupancy();
+    }
+    result.occupancy = layers.empty() ? 0.0f : occupied / static_cast<float>(layers.size());
+    return result;
+}
@@ -0,0 +1,118 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "AssetPackFormat.h"
+
+struct Sprite;
+
+// Pixel rectangle inside one atlas layer
+struct AtlasRect {
+    int x = 0, y = 0, width = 0, height = 0;
+};
+
+// MaxRects bin packer (best short side fit) for one layer. Keeps the list
+// of maximal free rectangles, so freed space can be reused at runtime.
+class MaxRectsPacker {
+public:
+    MaxRectsPacker(int width, int height);
+
+    // Find room for a width x height rectangle; false if it does not fit
+    bool insert(int width, int height, AtlasRect& placed);
+
+    // Give a rectangle returned by insert() back
+    void release(const AtlasRect& rect);
+
+    // Forget every placement
+    void reset();
+
+    // Fraction of the area handed out
+    float occupancy() const;
+
+private:
+    void splitFreeRects(const AtlasRect& placed);
+    void pruneFreeRects();
+
+    int width, height;
+    long long usedArea = 0;
+    std::vector<AtlasRect> freeRects;
+};
+
+// Where an image ended up
+struct AtlasRegion {
+    unsigned int layer = 0;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+    AtlasRect rect; // Texels written by upload(), whole blocks if compressed
+};
+
+struct TextureAtlasStats {
+    unsigned int images = 0;
+    unsigned int layersUsed = 0;
+    unsigned int failedInserts = 0; // Images that did not fit anywhere
+    float occupancy = 0.0f;         // Packed area over the area of all layers
+};
+
+// Packs many small images into one GL_TEXTURE_2D_ARRAY, so sprites using
+// any of them share a single texture binding and batch together. Images
+// can be inserted and evicted while the game runs. A texture has a single
+// format, so block-compressed images need an atlas of their own; such an
+// atlas places images on the 4x4 block grid.
+class TextureAtlas {
+public:
+    unsigned int ID; // GL_TEXTURE_2D_ARRAY name
+
+    // size x size layers, all allocated up front. padding pixels are kept
+    // empty around each image so filtering does not bleed between neighbors.
+    // format is an AssetPackFormat::ImageFormat the context supports (see
+    // TextureFormat::isSupported); compressed atlases round size and
+    // padding up to whole blocks.
+    TextureAtlas(int size = 1024, int layers = 4, int padding = 1,
+                 uint32_t format = AssetPackFormat::FORMAT_RGBA8);
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // Pack and upload an image in the atlas's format, rows (or block rows)
+    // bottom to top as GL expects. Returns a non-zero handle, or 0 if no
+    // layer has room.
+    uint32_t insert(const void* pixels, int width, int height);
+
+    // Reserve space for an image without uploading it; fill it with upload()
+    uint32_t allocate(int width, int height);
+
+    // Upload an allocated image's pixels. Uses whatever buffer is bound to
+    // GL_PIXEL_UNPACK_BUFFER, in which case pixels is a byte offset into it.
+    void upload(uint32_t handle, const void* pixels);
+
+    // Free an image's space; the handle may be reused by a later insert
+    void evict(uint32_t handle);
+
+    // Region of a live handle, nullptr otherwise
+    const AtlasRegion* region(uint32_t handle) const;
+
+    // Point a sprite at an image: sets texture, layer and UVs
+    void apply(uint32_t handle, Sprite& sprite) const;
+
+    int size() const { return layerSize; }
+    uint32_t format() const { return imageFormat; }
+    TextureAtlasStats stats() const;
+
+private:
+    struct Entry {
+        AtlasRegion region;
+        bool live = false;
+    };
+
+    int layerSize, padding;
+    uint32_t imageFormat;
+    std::vector<MaxRectsPacker> layers;
+    std::vector<unsigned int> layerImages; // Live images per layer
+    std::vector<Entry> entries;            // Handle - 1 indexes this
+    std::vector<uint32_t> freeHandles;
+    unsigned int failedInserts = 0;
+};
+
+#endif
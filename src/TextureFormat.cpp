@@ -0,0 +1,97 @@
+#include "TextureFormat.h"
+#include "BlockCompression.h"
+#include "GLExtensions.h"
+#include "Image.h"
+
+using namespace AssetPackFormat;
+
+namespace {
+
+// GL_EXT_texture_compression_s3tc
+const GLenum COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+const GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+// GL_ARB_texture_compression_bptc
+const GLenum COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C;
+// GL_ARB_ES3_compatibility
+const GLenum COMPRESSED_RGBA8_ETC2_EAC = 0x9278;
+
+}
+
+namespace TextureFormat {
+
+GLenum internalFormat(uint32_t format) {
+    switch (format) {
+    case FORMAT_RGBA8: return GL_RGBA8;
+    case FORMAT_BC1: return COMPRESSED_RGBA_S3TC_DXT1;
+    case FORMAT_BC3: return COMPRESSED_RGBA_S3TC_DXT5;
+    case FORMAT_BC7: return COMPRESSED_RGBA_BPTC_UNORM;
+    case FORMAT_ETC2_RGBA8: return COMPRESSED_RGBA8_ETC2_EAC;
+    default: return 0;
+    }
+}
+
+bool isCompressed(uint32_t format) {
+    return format != FORMAT_RGBA8;
+}
+
+int blockSize(uint32_t format) {
+    return isCompressed(format) ? 4 : 1;
+}
+
+size_t imageSize(uint32_t format, int width, int height) {
+    switch (format) {
+    case FORMAT_RGBA8:
+        return static_cast<size_t>(width) * height * 4;
+    case FORMAT_BC1:
+        return BlockCompression::bc1Size(width, height);
+    default:
+        // BC3, BC7 and ETC2 + EAC all use 16 bytes per block
+        return BlockCompression::bc3Size(width, height);
+    }
+}
+
+bool isSupported(uint32_t format) {
+    switch (format) {
+    case FORMAT_RGBA8:
+        return true;
+    case FORMAT_BC1:
+    case FORMAT_BC3:
+        return GLExtensions::has("GL_EXT_texture_compression_s3tc");
+    case FORMAT_BC7:
+        return GLExtensions::has("GL_ARB_texture_compression_bptc");
+    case FORMAT_ETC2_RGBA8:
+        return GLExtensions::has("GL_ARB_ES3_compatibility");
+    default:
+        return false;
+    }
+}
+
+bool decode(uint32_t format, const void* data, int width, int height, Image& image) {
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    const uint8_t* blocks = static_cast<const uint8_t*>(data);
+    switch (format) {
+    case FORMAT_BC1:
+        BlockCompression::decodeBC1(blocks, width, height, image.pixels.data());
+        return true;
+    case FORMAT_BC3:
+        BlockCompression::decodeBC3(blocks, width, height, image.pixels.data());
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* name(uint32_t format) {
+    switch (format) {
+    case FORMAT_RGBA8: return "RGBA8";
+    case FORMAT_BC1: return "BC1";
+    case FORMAT_BC3: return "BC3";
+    case FORMAT_BC7: return "BC7";
+    case FORMAT_ETC2_RGBA8: return "ETC2";
+    default: return "unknown";
+    }
+}
+
+}
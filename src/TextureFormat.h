@@ -0,0 +1,39 @@
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include "AssetPackFormat.h"
+
+struct Image;
+
+// GL side of the pack's image formats (AssetPackFormat::ImageFormat).
+// Block-compressed formats cut texture memory and upload bandwidth 4-8x
+// over RGBA8, but need an extension the GL 4.1 context may not expose.
+namespace TextureFormat {
+
+// Internal format to allocate a texture with, 0 for an unknown format
+GLenum internalFormat(uint32_t format);
+
+bool isCompressed(uint32_t format);
+
+// Texels per block edge: 4 for compressed formats, 1 for RGBA8
+int blockSize(uint32_t format);
+
+// Bytes of a width x height image, whole blocks for compressed formats
+size_t imageSize(uint32_t format, int width, int height);
+
+// True if the context can sample the format. Extensions are read on
+// first use, so call this from the GL thread once before asking elsewhere.
+bool isSupported(uint32_t format);
+
+// CPU decode to RGBA8, the fallback when the context lacks the format.
+// False for formats without a decoder (BC7, ETC2).
+bool decode(uint32_t format, const void* data, int width, int height, Image& image);
+
+const char* name(uint32_t format);
+
+}
+
+#endif
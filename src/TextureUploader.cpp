@@ -0,0 +1,165 @@
+#include "TextureUploader.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include <iostream>
+
+TextureUploader::TextureUploader(unsigned int bufferCount, size_t bufferSize, unsigned int workerCount)
+    : buffers(bufferCount < 1 ? 1 : bufferCount) {
+    GLStateCache& state = GLStateCache::instance();
+    for (Buffer& buffer : buffers) {
+        glGenBuffers(1, &buffer.ID);
+        state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.ID);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bufferSize), nullptr, GL_STREAM_DRAW);
+        buffer.capacity = bufferSize;
+    }
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (unsigned int i = 0; i < (workerCount < 1 ? 1 : workerCount); ++i)
+        workers.emplace_back(&TextureUploader::workerLoop, this);
+}
+
+TextureUploader::~TextureUploader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    GLStateCache& state = GLStateCache::instance();
+    for (const std::shared_ptr<Job>& job : active) {
+        state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[job->buffer].ID);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    for (Buffer& buffer : buffers) {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        state.deleteBuffer(buffer.ID);
+    }
+}
+
+void TextureUploader::submit(size_t size, FillFn fill, UploadFn upload, FailFn failed) {
+    auto job = std::make_shared<Job>();
+    job->size = size;
+    job->fill = std::move(fill);
+    job->upload = std::move(upload);
+    job->failed = std::move(failed);
+    waiting.push_back(std::move(job));
+}
+
+void TextureUploader::update() {
+    GLStateCache& state = GLStateCache::instance();
+
+    // Buffers whose upload the GPU has consumed are free again
+    for (Buffer& buffer : buffers) {
+        if (!buffer.fence)
+            continue;
+        if (glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            continue;
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+        buffer.busy = false;
+    }
+
+    // Issue the uploads the workers have finished writing, oldest first
+    for (auto it = active.begin(); it != active.end();) {
+        Job& job = **it;
+        if (!job.filled.load(std::memory_order_acquire)) {
+            ++it;
+            continue;
+        }
+        Buffer& buffer = buffers[job.buffer];
+        state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.ID);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE) {
+            job.upload(nullptr);
+            counters.uploads++;
+            counters.bytes += job.size;
+        } else {
+            // The driver lost the mapping (e.g. mode switch); the contents are undefined
+            std::cerr << "ERROR::TEXTURE_UPLOADER::UNMAP_FAILED" << std::endl;
+            counters.failed++;
+            if (job.failed)
+                job.failed();
+        }
+        buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        it = active.erase(it);
+    }
+
+    // Give every waiting job a free buffer, growing it if the job is larger
+    bool dispatched = false;
+    while (!waiting.empty()) {
+        int free = -1;
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (!buffers[i].busy) {
+                free = static_cast<int>(i);
+                break;
+            }
+        }
+        if (free < 0) {
+            counters.waits++;
+            break;
+        }
+
+        std::shared_ptr<Job> job = std::move(waiting.front());
+        waiting.pop_front();
+        Buffer& buffer = buffers[free];
+        state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.ID);
+        if (job->size > buffer.capacity) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(job->size), nullptr, GL_STREAM_DRAW);
+            buffer.capacity = job->size;
+        }
+        // The fence has passed, so invalidating and writing needs no synchronization
+        job->mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(job->size),
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!job->mapped) {
+            std::cerr << "ERROR::TEXTURE_UPLOADER::MAP_FAILED" << std::endl;
+            waiting.push_front(std::move(job)); // Try again next frame
+            break;
+        }
+        buffer.busy = true;
+        job->buffer = free;
+        active.push_back(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fills.push_back(std::move(job));
+        }
+        dispatched = true;
+    }
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (dispatched)
+        wake.notify_all();
+
+    counters.buffersInFlight = 0;
+    for (const Buffer& buffer : buffers) {
+        if (buffer.busy)
+            counters.buffersInFlight++;
+    }
+}
+
+void TextureUploader::flush() {
+    while (pending() > 0) {
+        update();
+        std::this_thread::yield();
+    }
+}
+
+void TextureUploader::workerLoop() {
+    Profiler::instance().setThreadName("Upload worker");
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !fills.empty(); });
+            if (stopping)
+                return;
+            job = std::move(fills.front());
+            fills.pop_front();
+        }
+        {
+            PROFILE_SCOPE("Fill upload buffer");
+            job->fill(job->mapped);
+        }
+        job->filled.store(true, std::memory_order_release);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+
+// Counters since startup, except buffersInFlight
+struct TextureUploaderStats {
+    unsigned int uploads = 0;         // glTexSubImage calls issued from a PBO
+    size_t bytes = 0;
+    unsigned int buffersInFlight = 0; // Mapped, filling or waiting on the GPU right now
+    unsigned int waits = 0;           // update() calls where a job found no free buffer
+    unsigned int failed = 0;          // Jobs dropped because their buffer could not be unmapped
+};
+
+// Pool of GL_PIXEL_UNPACK_BUFFER staging buffers. The GL thread maps a free
+// buffer for each submitted job, a worker thread copies (or decodes) the
+// pixels straight into the mapping, and once filled the GL thread unmaps it
+// and issues the texture upload from the buffer. A fence per buffer tells
+// when the GPU has pulled the data and the buffer can be mapped again, so
+// neither side ever blocks on the other.
+class TextureUploader {
+public:
+    // Runs on a worker: write exactly the submitted number of bytes
+    typedef std::function<void(void* destination)> FillFn;
+
+    // Runs on the GL thread with the filled buffer bound to
+    // GL_PIXEL_UNPACK_BUFFER: issue glTexSubImage* with pixels as the offset
+    typedef std::function<void(const void* pixels)> UploadFn;
+
+    // Runs on the GL thread instead of UploadFn when the buffer's contents
+    // were lost, so the owner can release what it set aside for the upload
+    typedef std::function<void()> FailFn;
+
+    TextureUploader(unsigned int bufferCount = 4, size_t bufferSize = 4 * 1024 * 1024,
+                    unsigned int workerCount = 1);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // Queue an upload of size bytes; it starts on the next update(). Exactly
+    // one of upload and failed is called.
+    void submit(size_t size, FillFn fill, UploadFn upload, FailFn failed = FailFn());
+
+    // Call once per frame on the GL thread: recycle buffers the GPU is done
+    // with, issue uploads whose buffers are filled and map buffers for
+    // waiting jobs
+    void update();
+
+    // Block until every submitted upload has been issued
+    void flush();
+
+    // Jobs not issued yet
+    size_t pending() const { return waiting.size() + active.size(); }
+
+    const TextureUploaderStats& stats() const { return counters; }
+
+private:
+    struct Buffer {
+        unsigned int ID = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        bool busy = false; // Mapped for a job or waiting on its fence
+    };
+
+    struct Job {
+        size_t size;
+        FillFn fill;
+        UploadFn upload;
+        FailFn failed;
+        int buffer = -1;
+        void* mapped = nullptr;
+        std::atomic<bool> filled{ false };
+    };
+
+    void workerLoop();
+
+    std::vector<Buffer> buffers;
+    std::deque<std::shared_ptr<Job>> waiting; // No buffer yet, GL thread only
+    std::deque<std::shared_ptr<Job>> active;  // Mapped and handed to a worker
+
+    std::mutex mutex; // Guards fills and stopping
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Job>> fills;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    TextureUploaderStats counters;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "TraceCapture.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <glad/glad.h>
+
+namespace {
+
+// Frames to keep collecting GPU results after the last captured frame
+const unsigned int GPU_WAIT_LIMIT = 2 * Profiler::GPU_LATENCY;
+
+void writeString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+}
+
+TraceCapture::TraceCapture(const std::string& path, unsigned int frameCount)
+    : path(path), frameCount(frameCount) {
+    // GL_TIMESTAMP read now is the GPU clock at this moment; the offset
+    // carries GPU query results onto the CPU timeline
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuToCpu = static_cast<int64_t>(Profiler::now()) - static_cast<int64_t>(gpuNow);
+    mainThread = Profiler::instance().threadIndex();
+}
+
+void TraceCapture::recordFrame(const Profiler& profiler) {
+    if (finished)
+        return;
+
+    const FrameProfile& frame = profiler.lastFrame();
+    if (framesCaptured < frameCount) {
+        if (framesCaptured == 0)
+            firstFrame = frame.frame;
+        lastFrame = frame.frame;
+        framesCaptured++;
+        frames.push_back(frame);
+        events.insert(events.end(), profiler.events().begin(), profiler.events().end());
+        counters.insert(counters.end(), profiler.counterValues().begin(), profiler.counterValues().end());
+    } else {
+        gpuWaitFrames++;
+    }
+
+    // GPU results arrive a few frames late; take each resolved frame once
+    if (frame.gpuFrame != lastGpuFrame && frame.gpuFrame >= firstFrame && frame.gpuFrame <= lastFrame) {
+        for (GpuProfileEvent event : profiler.gpuEvents()) {
+            event.start = static_cast<uint64_t>(static_cast<int64_t>(event.start) + gpuToCpu);
+            event.end = static_cast<uint64_t>(static_cast<int64_t>(event.end) + gpuToCpu);
+            gpuEvents.push_back(event);
+        }
+    }
+    lastGpuFrame = frame.gpuFrame;
+
+    if (framesCaptured == frameCount && (lastGpuFrame >= lastFrame || gpuWaitFrames >= GPU_WAIT_LIMIT))
+        finish();
+}
+
+bool TraceCapture::finish() {
+    if (finished)
+        return true;
+    finished = true;
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "ERROR::TRACE_CAPTURE::CANNOT_WRITE\n" << path << std::endl;
+        return false;
+    }
+
+    // Timestamps are microseconds from the earliest event
+    uint64_t origin = frames.empty() ? 0 : frames.front().start;
+    for (const ProfileEvent& event : events)
+        origin = std::min(origin, event.start);
+    auto micros = [origin](uint64_t time) {
+        return (static_cast<double>(time) - static_cast<double>(origin)) / 1000.0;
+    };
+
+    std::vector<std::string> names = Profiler::instance().threadNames();
+    uint32_t gpuTrack = static_cast<uint32_t>(names.size());
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GameEngine2D\"}}";
+    for (uint32_t i = 0; i <= gpuTrack; ++i) {
+        std::string name = i == gpuTrack ? "GPU" : names[i].empty() ? "Thread " + std::to_string(i) : names[i];
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+        writeString(out, name);
+        out << "}}";
+    }
+
+    for (const FrameProfile& frame : frames) {
+        out << ",\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << mainThread
+            << ",\"ts\":" << micros(frame.start) << ",\"dur\":" << (frame.end - frame.start) / 1000.0
+            << ",\"args\":{\"frame\":" << frame.frame << "}}";
+    }
+    for (const ProfileEvent& event : events) {
+        out << ",\n{\"name\":";
+        writeString(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << micros(event.start) << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+    for (const GpuProfileEvent& event : gpuEvents) {
+        out << ",\n{\"name\":";
+        writeString(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << gpuTrack
+            << ",\"ts\":" << micros(event.start) << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+    for (const ProfileCounter& counter : counters) {
+        out << ",\n{\"name\":";
+        writeString(out, counter.name);
+        out << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << micros(counter.time) << ",\"args\":{\"value\":" << counter.value << "}}";
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        std::cerr << "ERROR::TRACE_CAPTURE::WRITE_FAILED\n" << path << std::endl;
+        return false;
+    }
+    std::cout << "Wrote trace of " << framesCaptured << " frames to " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TRACE_CAPTURE_H
+#define TRACE_CAPTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Profiler.h"
+
+// Records the profiler's output for a number of frames and writes it as a
+// Chrome Trace Event JSON file, to open in Perfetto (ui.perfetto.dev) or
+// chrome://tracing. CPU scopes appear per thread, GPU scopes on a "GPU"
+// track aligned to the CPU clock, counters as counter tracks.
+class TraceCapture {
+public:
+    // Capture frameCount frames starting with the next one. Construct on
+    // the GL thread: the GPU clock is calibrated against the CPU clock here.
+    TraceCapture(const std::string& path, unsigned int frameCount);
+
+    // Collect the frame the profiler just finished. Call after
+    // Profiler::endFrame(); once every frame is in, the file is written.
+    void recordFrame(const Profiler& profiler);
+
+    // Write what has been captured, if not written yet. Returns false if
+    // the file cannot be written.
+    bool finish();
+
+    bool isFinished() const { return finished; }
+
+private:
+    std::string path;
+    unsigned int frameCount;
+    uint64_t firstFrame = 0, lastFrame = 0; // Profiler frame numbers captured
+    unsigned int framesCaptured = 0;
+    uint64_t lastGpuFrame = 0;
+    unsigned int gpuWaitFrames = 0;         // Frames since the CPU capture ended
+    int64_t gpuToCpu = 0;                   // Add to a GL timestamp to get steady_clock time
+    uint32_t mainThread = 0;                // Track the frame spans go on
+    bool finished = false;
+
+    std::vector<FrameProfile> frames;
+    std::vector<ProfileEvent> events;
+    std::vector<GpuProfileEvent> gpuEvents; // Already on the CPU clock
+    std::vector<ProfileCounter> counters;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "VertexLayout.h"
+
+namespace {
+
+struct FormatInfo {
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    bool integer; // Read with glVertexAttribIPointer
+    size_t size;
+};
+
+FormatInfo formatInfo(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Float1:            return { 1, GL_FLOAT, GL_FALSE, false, 4 };
+    case VertexFormat::Float2:            return { 2, GL_FLOAT, GL_FALSE, false, 8 };
+    case VertexFormat::Float3:            return { 3, GL_FLOAT, GL_FALSE, false, 12 };
+    case VertexFormat::Float4:            return { 4, GL_FLOAT, GL_FALSE, false, 16 };
+    case VertexFormat::Half2:             return { 2, GL_HALF_FLOAT, GL_FALSE, false, 4 };
+    case VertexFormat::Half4:             return { 4, GL_HALF_FLOAT, GL_FALSE, false, 8 };
+    case VertexFormat::UByte4Norm:        return { 4, GL_UNSIGNED_BYTE, GL_TRUE, false, 4 };
+    case VertexFormat::UShort2:           return { 2, GL_UNSIGNED_SHORT, GL_FALSE, true, 4 };
+    case VertexFormat::UShort2Norm:       return { 2, GL_UNSIGNED_SHORT, GL_TRUE, false, 4 };
+    case VertexFormat::Int2_10_10_10Norm: return { 4, GL_INT_2_10_10_10_REV, GL_TRUE, false, 4 };
+    }
+    return { 0, GL_FLOAT, GL_FALSE, false, 0 };
+}
+
+}
+
+VertexLayout& VertexLayout::add(GLuint location, VertexFormat format) {
+    attributeList.push_back({ location, format, recordSize });
+    recordSize += formatSize(format);
+    return *this;
+}
+
+size_t VertexLayout::formatSize(VertexFormat format) {
+    return formatInfo(format).size;
+}
+
+void VertexLayout::enable() const {
+    for (const Attribute& attribute : attributeList) {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribDivisor(attribute.location, divisor);
+    }
+}
+
+void VertexLayout::apply(size_t baseOffset) const {
+    GLsizei stride = static_cast<GLsizei>(recordSize);
+    for (const Attribute& attribute : attributeList) {
+        FormatInfo info = formatInfo(attribute.format);
+        const void* pointer = reinterpret_cast<const void*>(baseOffset + attribute.offset);
+        if (info.integer)
+            glVertexAttribIPointer(attribute.location, info.components, info.type, stride, pointer);
+        else
+            glVertexAttribPointer(attribute.location, info.components, info.type, info.normalized, stride, pointer);
+    }
+}
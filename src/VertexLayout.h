@@ -0,0 +1,98 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glad/glad.h>
+
+// Attribute formats, smallest that fits the data. A 2D sprite vertex is
+// Float2 position + Half2 UV + UByte4Norm color + UShort2 layer/flags = 20 bytes.
+enum class VertexFormat {
+    Float1, Float2, Float3, Float4,
+    Half2, Half4,      // GL_HALF_FLOAT, write with packHalf()
+    UByte4Norm,        // 0..255 read as 0..1, for colors
+    UShort2,           // Integer attribute, uvec2 in GLSL
+    UShort2Norm,       // 0..65535 read as 0..1
+    Int2_10_10_10Norm  // GL_INT_2_10_10_10_REV, write with packSnorm10()
+};
+
+// Describes an interleaved vertex (or instance) record and sets up the
+// matching attribute pointers, so the struct layout is written down once.
+class VertexLayout {
+public:
+    struct Attribute {
+        GLuint location;
+        VertexFormat format;
+        size_t offset;
+    };
+
+    // divisor 1 makes this a per-instance layout
+    explicit VertexLayout(GLuint divisor = 0) : divisor(divisor) {}
+
+    // Append an attribute right after the previous one
+    VertexLayout& add(GLuint location, VertexFormat format);
+
+    size_t stride() const { return recordSize; }
+    const std::vector<Attribute>& attributes() const { return attributeList; }
+
+    // Enable the attributes and set their divisor on the bound VAO
+    void enable() const;
+
+    // Point the attributes at the buffer bound to GL_ARRAY_BUFFER, with the
+    // first record at baseOffset bytes. Needs the VAO bound.
+    void apply(size_t baseOffset = 0) const;
+
+    static size_t formatSize(VertexFormat format);
+
+private:
+    std::vector<Attribute> attributeList;
+    size_t recordSize = 0;
+    GLuint divisor;
+};
+
+// 0..1 to an unsigned normalized byte, for UByte4Norm
+inline uint8_t packUnorm8(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+// Float to IEEE half, rounding to nearest
+inline uint16_t packHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t rawExponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    int exponent = static_cast<int>(rawExponent) - 127 + 15;
+
+    if (rawExponent == 0xFFu) // Inf and NaN
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    if (exponent >= 31)       // Too large, clamp to Inf
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    if (exponent <= 0) {      // Subnormal or zero
+        if (exponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = (mantissa >> shift) + ((mantissa >> (shift - 1)) & 1u);
+        return static_cast<uint16_t>(sign | half);
+    }
+    // A rounding carry out of the mantissa correctly bumps the exponent
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    return static_cast<uint16_t>(half + ((mantissa >> 12) & 1u));
+}
+
+// Pack -1..1 xyz and 0..1 w into GL_INT_2_10_10_10_REV
+inline uint32_t packSnorm10(float x, float y, float z, float w = 0.0f) {
+    auto snorm = [](float v, float scale, uint32_t mask) {
+        v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+        int value = static_cast<int>(v * scale + (v < 0.0f ? -0.5f : 0.5f));
+        return static_cast<uint32_t>(value) & mask;
+    };
+    return snorm(x, 511.0f, 0x3FFu) | (snorm(y, 511.0f, 0x3FFu) << 10)
+         | (snorm(z, 511.0f, 0x3FFu) << 20) | (snorm(w, 1.0f, 0x3u) << 30);
+}
+
+#endif
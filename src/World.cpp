@@ -0,0 +1,235 @@
+#include "World.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+struct ComponentInfo {
+    size_t size = 0;
+    size_t alignment = 1;
+};
+
+ComponentInfo componentInfo[MAX_COMPONENTS];
+std::atomic<unsigned int> componentCount{ 0 };
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Bytes a chunk layout with capacity rows needs
+size_t layoutSize(const std::vector<unsigned int>& components, size_t capacity) {
+    size_t end = capacity * sizeof(Entity);
+    for (unsigned int id : components)
+        end = alignUp(end, componentInfo[id].alignment) + capacity * componentInfo[id].size;
+    return end;
+}
+
+}
+
+unsigned int registerComponent(size_t size, size_t alignment) {
+    unsigned int id = componentCount.fetch_add(1);
+    if (id >= MAX_COMPONENTS) {
+        // Masks are 64 bits wide; nothing sensible to fall back to
+        std::cerr << "ERROR::WORLD::TOO_MANY_COMPONENT_TYPES\n"
+                  << "More than " << MAX_COMPONENTS << " component types" << std::endl;
+        std::abort();
+    }
+    componentInfo[id].size = size;
+    componentInfo[id].alignment = alignment;
+    return id;
+}
+
+const std::vector<Query::ChunkRef>& Query::collectChunks() {
+    chunkRefs.clear();
+    size_t first = 0;
+    for (Archetype* archetype : archetypes) {
+        for (const std::unique_ptr<Chunk>& chunk : archetype->chunks) {
+            chunkRefs.push_back({ archetype, chunk.get(), first });
+            first += chunk->count;
+        }
+    }
+    return chunkRefs;
+}
+
+size_t Query::count() const {
+    size_t total = 0;
+    for (const Archetype* archetype : archetypes)
+        total += archetype->count;
+    return total;
+}
+
+World::World() {
+    // Entities without components live in the empty archetype
+    findArchetype(0);
+}
+
+const World::Record* World::find(Entity entity) const {
+    if (entity.index == 0 || entity.index > records.size())
+        return nullptr;
+    const Record& record = records[entity.index - 1];
+    if (!record.archetype || record.generation != entity.generation)
+        return nullptr;
+    return &record;
+}
+
+bool World::isAlive(Entity entity) const {
+    return find(entity) != nullptr;
+}
+
+Archetype& World::findArchetype(ComponentMask mask) {
+    auto found = archetypeByMask.find(mask);
+    if (found != archetypeByMask.end())
+        return *found->second;
+
+    archetypes.push_back(std::make_unique<Archetype>());
+    Archetype& archetype = *archetypes.back();
+    archetype.mask = mask;
+    size_t rowSize = sizeof(Entity);
+    for (unsigned int id = 0; id < MAX_COMPONENTS; ++id) {
+        if (mask & (ComponentMask(1) << id)) {
+            archetype.components.push_back(id);
+            rowSize += componentInfo[id].size;
+        }
+    }
+
+    // As many rows as fit once each array is aligned
+    size_t capacity = Chunk::SIZE / rowSize;
+    while (capacity > 0 && layoutSize(archetype.components, capacity) > Chunk::SIZE)
+        capacity--;
+    if (capacity == 0) {
+        // Each component fits on its own (see ComponentType), but not together
+        std::cerr << "ERROR::WORLD::ARCHETYPE_TOO_LARGE\n"
+                  << "A row of " << rowSize << " bytes does not fit in a " << Chunk::SIZE << " byte chunk" << std::endl;
+        std::abort();
+    }
+    archetype.capacity = static_cast<uint32_t>(capacity);
+    size_t offset = capacity * sizeof(Entity);
+    for (unsigned int id : archetype.components) {
+        offset = alignUp(offset, componentInfo[id].alignment);
+        archetype.offsets[id] = offset;
+        offset += capacity * componentInfo[id].size;
+    }
+
+    archetypeByMask[mask] = &archetype;
+    for (auto& query : queries) {
+        if ((mask & query.first) == query.first)
+            query.second->archetypes.push_back(&archetype);
+    }
+    return archetype;
+}
+
+Query& World::findQuery(ComponentMask mask) {
+    std::unique_ptr<Query>& query = queries[mask];
+    if (!query) {
+        query = std::make_unique<Query>();
+        query->mask = mask;
+        for (const std::unique_ptr<Archetype>& archetype : archetypes) {
+            if ((archetype->mask & mask) == mask)
+                query->archetypes.push_back(archetype.get());
+        }
+    }
+    return *query;
+}
+
+Entity World::allocate(Archetype& archetype) {
+    uint32_t index;
+    if (!freeRecords.empty()) {
+        index = freeRecords.back();
+        freeRecords.pop_back();
+    } else {
+        records.emplace_back();
+        index = static_cast<uint32_t>(records.size() - 1);
+    }
+    Entity entity;
+    entity.index = index + 1;
+    entity.generation = records[index].generation;
+    records[index].archetype = &archetype;
+    records[index].row = appendRow(archetype, entity);
+    entityCount++;
+    return entity;
+}
+
+void World::destroy(Entity entity) {
+    if (!find(entity))
+        return;
+    Record& record = records[entity.index - 1];
+    removeRow(*record.archetype, record.row);
+    record.archetype = nullptr;
+    record.generation++;
+    freeRecords.push_back(entity.index - 1);
+    entityCount--;
+}
+
+uint32_t World::appendRow(Archetype& archetype, Entity entity) {
+    uint32_t row = archetype.count++;
+    if (row / archetype.capacity == archetype.chunks.size()) {
+        // Reuse the spare; a new chunk is left uninitialized, rows are
+        // written before they are read
+        if (archetype.spare) {
+            archetype.chunks.push_back(std::move(archetype.spare));
+        } else {
+            archetype.chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+            chunksAllocated++;
+        }
+    }
+    Chunk& chunk = *archetype.chunks[row / archetype.capacity];
+    archetype.entities(chunk)[row % archetype.capacity] = entity;
+    chunk.count++;
+    return row;
+}
+
+void World::removeRow(Archetype& archetype, uint32_t row) {
+    // Fill the hole with the last row so the chunks stay packed
+    uint32_t last = archetype.count - 1;
+    Chunk& lastChunk = *archetype.chunks[last / archetype.capacity];
+    if (row != last) {
+        Chunk& chunk = *archetype.chunks[row / archetype.capacity];
+        Entity moved = archetype.entities(lastChunk)[last % archetype.capacity];
+        archetype.entities(chunk)[row % archetype.capacity] = moved;
+        for (unsigned int id : archetype.components) {
+            size_t size = componentInfo[id].size;
+            std::memcpy(archetype.component(row, id, size), archetype.component(last, id, size), size);
+        }
+        records[moved.index - 1].row = row;
+    }
+    archetype.count--;
+    if (--lastChunk.count == 0) {
+        // Keep one empty chunk, so adding and removing across a chunk
+        // boundary does not allocate and free 16 KB every time
+        archetype.spare = std::move(archetype.chunks.back());
+        archetype.chunks.pop_back();
+    }
+}
+
+void World::move(Record& record, Archetype& target) {
+    Archetype& source = *record.archetype;
+    Entity entity = source.entities(*source.chunks[record.row / source.capacity])[record.row % source.capacity];
+    uint32_t row = appendRow(target, entity);
+
+    // Components in both archetypes carry over; added ones are written by the caller
+    for (unsigned int id : target.components) {
+        if (source.mask & (ComponentMask(1) << id)) {
+            size_t size = componentInfo[id].size;
+            std::memcpy(target.component(row, id, size), source.component(record.row, id, size), size);
+        }
+    }
+    removeRow(source, record.row);
+    record.archetype = &target;
+    record.row = row;
+}
+
+unsigned char* World::component(const Record& record, unsigned int id) const {
+    return record.archetype->component(record.row, id, componentInfo[id].size);
+}
+
+WorldStats World::stats() const {
+    WorldStats stats;
+    stats.entities = entityCount;
+    stats.archetypes = archetypes.size();
+    for (const std::unique_ptr<Archetype>& archetype : archetypes)
+        stats.chunks += archetype->chunks.size();
+    stats.chunksAllocated = chunksAllocated;
+    return stats;
+}
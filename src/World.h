@@ -0,0 +1,283 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+
+// Reference to an entity. A destroyed entity's slot bumps its generation,
+// so stale handles are detected instead of aliasing a new entity.
+struct Entity {
+    uint32_t index = 0; // Record + 1, 0 = null handle
+    uint32_t generation = 0;
+
+    explicit operator bool() const { return index != 0; }
+    bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// One bit per component type
+typedef uint64_t ComponentMask;
+const unsigned int MAX_COMPONENTS = 64;
+
+// A block of rows of one archetype. Each component is an array of its own
+// (structure of arrays), so a system touching two components streams
+// through two dense arrays instead of striding over whole entities.
+struct Chunk {
+    static const size_t SIZE = 16 * 1024;
+
+    alignas(64) unsigned char data[SIZE];
+    uint32_t count = 0;
+};
+
+// Assigns ids to component types in order of first use. Components are
+// plain data: they are moved between chunks with memcpy and never destroyed.
+unsigned int registerComponent(size_t size, size_t alignment);
+
+template <typename T>
+struct ComponentType {
+    static_assert(std::is_trivially_copyable<T>::value, "Components must be trivially copyable");
+    static_assert(alignof(T) <= 64, "Components must not be aligned beyond a cache line");
+    static_assert(sizeof(T) + sizeof(Entity) <= Chunk::SIZE, "Component does not fit in a chunk");
+
+    static unsigned int id() {
+        static const unsigned int id = registerComponent(sizeof(T), alignof(T));
+        return id;
+    }
+};
+
+// const T names the same component as T, for read-only views
+template <typename T>
+unsigned int componentId() {
+    return ComponentType<typename std::remove_cv<T>::type>::id();
+}
+
+template <typename... Ts>
+ComponentMask componentMask() {
+    return (ComponentMask(0) | ... | (ComponentMask(1) << componentId<Ts>()));
+}
+
+// All entities with exactly the same set of components. Rows are packed:
+// every chunk but the last is full.
+struct Archetype {
+    ComponentMask mask = 0;
+    std::vector<unsigned int> components; // Ids, ascending
+    size_t offsets[MAX_COMPONENTS];       // Byte offset of each component's array in a chunk
+    uint32_t capacity = 0;                // Rows per chunk
+    uint32_t count = 0;                   // Rows in use
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::unique_ptr<Chunk> spare;         // Last chunk emptied, kept for the next append
+
+    // Archetypes one component away, filled in as entities migrate
+    Archetype* addEdges[MAX_COMPONENTS] = {};
+    Archetype* removeEdges[MAX_COMPONENTS] = {};
+
+    // Entity of each row of a chunk; offset 0
+    Entity* entities(Chunk& chunk) const { return reinterpret_cast<Entity*>(chunk.data); }
+
+    template <typename T>
+    T* array(Chunk& chunk) const { return reinterpret_cast<T*>(chunk.data + offsets[componentId<T>()]); }
+
+    unsigned char* component(uint32_t row, unsigned int id, size_t size) const {
+        return chunks[row / capacity]->data + offsets[id] + (row % capacity) * size;
+    }
+};
+
+// The archetypes holding at least a given set of components. World keeps
+// each one up to date as archetypes are created, so iterating never
+// searches.
+struct Query {
+    struct ChunkRef {
+        Archetype* archetype;
+        Chunk* chunk;
+        size_t first; // Rows of the query before this chunk
+    };
+
+    ComponentMask mask = 0;
+    std::vector<Archetype*> archetypes;
+    std::vector<ChunkRef> chunkRefs; // Rebuilt by collectChunks()
+
+    const std::vector<ChunkRef>& collectChunks();
+    size_t count() const;
+};
+
+// Typed access to a cached query. Callbacks get each chunk's arrays:
+// fn(first, count, Ts* arrays...), where first numbers the chunk's rows
+// across the whole query in iteration order. Ts may be const for
+// components that are only read.
+template <typename... Ts>
+class View {
+public:
+    explicit View(Query& query) : query(&query) {}
+
+    // fn(Ts&... components) for every row
+    template <typename Fn>
+    void forEach(const Fn& fn) const {
+        forEachChunk([&fn](size_t, size_t count, Ts*... arrays) {
+            for (size_t i = 0; i < count; ++i)
+                fn(arrays[i]...);
+        });
+    }
+
+    template <typename Fn>
+    void forEachChunk(const Fn& fn) const {
+        size_t first = 0;
+        for (Archetype* archetype : query->archetypes) {
+            for (const std::unique_ptr<Chunk>& chunk : archetype->chunks) {
+                fn(first, chunk->count, archetype->template array<Ts>(*chunk)...);
+                first += chunk->count;
+            }
+        }
+    }
+
+    // forEachChunk() with chunks spread over the job system. Not for two
+    // threads at once on the same query.
+    template <typename Fn>
+    void parallelForEachChunk(JobSystem& jobs, const Fn& fn) const {
+        const std::vector<Query::ChunkRef>& chunks = query->collectChunks();
+        jobs.parallelFor(chunks.size(), [&chunks, &fn](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Query::ChunkRef& ref = chunks[i];
+                fn(ref.first, ref.chunk->count, ref.archetype->template array<Ts>(*ref.chunk)...);
+            }
+        });
+    }
+
+    size_t count() const { return query->count(); }
+
+private:
+    Query* query;
+};
+
+struct WorldStats {
+    size_t entities = 0;
+    size_t archetypes = 0;
+    size_t chunks = 0;          // In use, not counting spares
+    size_t chunksAllocated = 0; // Since startup
+};
+
+// Archetype-based entity component system. Entities are grouped by their
+// exact component set into archetypes, each storing its components in
+// 16 KB structure-of-arrays chunks. Removing an entity or moving it to
+// another archetype (adding or removing a component) moves the last row
+// into the hole, so it is O(1) and chunks stay dense for linear
+// iteration. Not thread-safe: structural changes and iteration happen on
+// one thread, though a chunk iteration may fan out over a JobSystem.
+class World {
+public:
+    World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Create an entity with the given components (at most one of each type)
+    template <typename... Ts>
+    Entity create(const Ts&... components);
+
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+
+    // Add a component, or overwrite it if the entity already has one
+    template <typename T>
+    void add(Entity entity, const T& component = T());
+
+    template <typename T>
+    void remove(Entity entity);
+
+    // The entity's component, nullptr if it has none or the handle is stale.
+    // Invalidated by any structural change.
+    template <typename T>
+    T* get(Entity entity);
+
+    template <typename T>
+    bool has(Entity entity) const;
+
+    // Entities with at least the components Ts
+    template <typename... Ts>
+    View<Ts...> query() { return View<Ts...>(findQuery(componentMask<Ts...>())); }
+
+    WorldStats stats() const;
+
+private:
+    struct Record {
+        Archetype* archetype = nullptr; // nullptr while the slot is free
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    const Record* find(Entity entity) const;
+    Archetype& findArchetype(ComponentMask mask);
+    Query& findQuery(ComponentMask mask);
+    Entity allocate(Archetype& archetype);
+    uint32_t appendRow(Archetype& archetype, Entity entity);
+    void removeRow(Archetype& archetype, uint32_t row);
+    void move(Record& record, Archetype& target);
+    unsigned char* component(const Record& record, unsigned int id) const;
+
+    std::vector<Record> records;
+    std::vector<uint32_t> freeRecords;
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> archetypeByMask;
+    std::unordered_map<ComponentMask, std::unique_ptr<Query>> queries;
+    size_t entityCount = 0;
+    size_t chunksAllocated = 0;
+};
+
+template <typename... Ts>
+Entity World::create(const Ts&... components) {
+    Entity entity = allocate(findArchetype(componentMask<Ts...>()));
+    const Record& record = records[entity.index - 1];
+    (new (component(record, componentId<Ts>())) Ts(components), ...);
+    return entity;
+}
+
+template <typename T>
+void World::add(Entity entity, const T& value) {
+    const Record* found = find(entity);
+    if (!found)
+        return;
+    Record& record = records[entity.index - 1];
+    unsigned int id = componentId<T>();
+    if (!(record.archetype->mask & (ComponentMask(1) << id))) {
+        Archetype*& edge = record.archetype->addEdges[id];
+        if (!edge)
+            edge = &findArchetype(record.archetype->mask | (ComponentMask(1) << id));
+        move(record, *edge);
+    }
+    new (component(record, id)) T(value);
+}
+
+template <typename T>
+void World::remove(Entity entity) {
+    const Record* found = find(entity);
+    unsigned int id = componentId<T>();
+    if (!found || !(found->archetype->mask & (ComponentMask(1) << id)))
+        return;
+    Record& record = records[entity.index - 1];
+    Archetype*& edge = record.archetype->removeEdges[id];
+    if (!edge)
+        edge = &findArchetype(record.archetype->mask & ~(ComponentMask(1) << id));
+    move(record, *edge);
+}
+
+template <typename T>
+T* World::get(Entity entity) {
+    const Record* record = find(entity);
+    unsigned int id = componentId<T>();
+    if (!record || !(record->archetype->mask & (ComponentMask(1) << id)))
+        return nullptr;
+    return reinterpret_cast<T*>(component(*record, id));
+}
+
+template <typename T>
+bool World::has(Entity entity) const {
+    const Record* record = find(entity);
+    return record && (record->archetype->mask & (ComponentMask(1) << componentId<T>()));
+}
+
+#endif
@@ -0,0 +1,164 @@
+// Stress test of JobSystem: every range and job runs exactly once, parents
+// wait for their children, and threads beyond the workers can join in.
+// Worth running under ThreadSanitizer after touching the deque.
+#include "JobSystem.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const unsigned int WORKERS = 7;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            return false;                                                                 \
+        }                                                                                 \
+    } while (0)
+
+// parallelFor visits each index of [0, count) exactly once
+bool coversRange(JobSystem& jobs, size_t count, size_t minChunk) {
+    std::vector<int> visits(count, 0);
+    jobs.parallelFor(count, [&visits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            visits[i]++;
+    }, minChunk);
+    for (size_t i = 0; i < count; ++i)
+        CHECK(visits[i] == 1);
+    return true;
+}
+
+bool testParallelFor(JobSystem& jobs) {
+    // Fewer items than threads times the grain, then far more
+    for (size_t count : { 0, 1, 3, 7, 64, 1000 })
+        CHECK(coversRange(jobs, count, 16));
+    for (int round = 0; round < 50; ++round)
+        CHECK(coversRange(jobs, 100000 + round, 1));
+    CHECK(coversRange(jobs, 1 << 20, 256));
+    return true;
+}
+
+// Children created with a parent keep it unfinished, down two levels
+bool testNestedJobs(JobSystem& jobs) {
+    std::atomic<int> executed{ 0 };
+    for (int round = 0; round < 200; ++round) {
+        Job* root = jobs.createJob([] {});
+        for (int i = 0; i < 100; ++i) {
+            std::atomic<int>* counter = &executed;
+            JobSystem* system = &jobs;
+            Job* parent = root;
+            jobs.run(jobs.createJob([counter, system, parent] {
+                counter->fetch_add(1);
+                system->run(system->createJob([counter] { counter->fetch_add(1); }, parent));
+            }, root));
+        }
+        jobs.run(root);
+        jobs.wait(root);
+        CHECK(executed.load() == (round + 1) * 200);
+    }
+    return true;
+}
+
+// Jobs that themselves fan out with parallelFor on the workers
+bool testNestedParallelFor(JobSystem& jobs) {
+    std::vector<std::atomic<int>> sums(64);
+    for (std::atomic<int>& sum : sums)
+        sum = 0;
+    jobs.parallelFor(sums.size(), [&jobs, &sums](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            jobs.parallelFor(1000, [&sums, i](size_t first, size_t last) {
+                sums[i].fetch_add(static_cast<int>(last - first));
+            }, 8);
+        }
+    });
+    for (std::atomic<int>& sum : sums)
+        CHECK(sum.load() == 1000);
+    return true;
+}
+
+// Other threads register on first use and share work with the workers;
+// past MAX_EXTERNAL_THREADS their parallelFor runs inline
+bool testExternalThreads(JobSystem& jobs) {
+    std::atomic<bool> failed{ false };
+    auto worker = [&jobs, &failed](bool registered) {
+        for (int round = 0; round < 20; ++round) {
+            if (!coversRange(jobs, 50000, 32))
+                failed = true;
+            if (!registered)
+                continue;
+            std::atomic<int> executed{ 0 };
+            Job* root = jobs.createJob([] {});
+            std::atomic<int>* counter = &executed;
+            for (int i = 0; i < 50; ++i)
+                jobs.run(jobs.createJob([counter] { counter->fetch_add(1); }, root));
+            jobs.run(root);
+            jobs.wait(root);
+            if (executed.load() != 50)
+                failed = true;
+        }
+    };
+
+    // The main thread holds one external slot already
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < JobSystem::MAX_EXTERNAL_THREADS; ++i)
+        threads.emplace_back(worker, true);
+    for (std::thread& thread : threads)
+        thread.join();
+    CHECK(!failed);
+
+    std::cerr << "(one TOO_MANY_THREADS error expected)\n";
+    std::thread extra(worker, false);
+    extra.join();
+    CHECK(!failed);
+    return true;
+}
+
+// With the calling thread's whole pool alive, parallelFor runs inline
+// instead of waiting for a job that cannot finish
+bool testPoolExhausted(JobSystem& jobs) {
+    std::atomic<int> executed{ 0 };
+    std::atomic<int>* counter = &executed;
+    Job* root = jobs.createJob([] {});
+    std::vector<Job*> held;
+    for (unsigned int i = 1; i < JobSystem::POOL_SIZE; ++i)
+        held.push_back(jobs.createJob([counter] { counter->fetch_add(1); }, root));
+
+    CHECK(coversRange(jobs, 10000, 1));
+
+    for (Job* job : held)
+        jobs.run(job);
+    jobs.run(root);
+    jobs.wait(root);
+    CHECK(executed.load() == static_cast<int>(JobSystem::POOL_SIZE - 1));
+    return true;
+}
+
+}
+
+int main() {
+    JobSystem jobs(WORKERS);
+    struct {
+        const char* name;
+        bool (*run)(JobSystem&);
+    } tests[] = {
+        { "parallelFor", testParallelFor },
+        { "nested jobs", testNestedJobs },
+        { "nested parallelFor", testNestedParallelFor },
+        { "pool exhausted", testPoolExhausted },
+        { "external threads", testExternalThreads },
+    };
+
+    int failures = 0;
+    for (const auto& test : tests) {
+        bool passed = test.run(jobs);
+        std::cout << (passed ? "PASS " : "FAIL ") << test.name << std::endl;
+        if (!passed)
+            failures++;
+    }
+    JobSystemStats stats = jobs.stats();
+    std::cout << stats.jobs << " jobs, " << stats.steals << " stolen" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
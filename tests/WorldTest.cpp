@@ -0,0 +1,200 @@
+// Randomized test of World against a plain list of expected components:
+// swap-remove row fix-ups, generation checks and the query cache.
+#include "World.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Value {
+    int value;
+};
+
+struct Weight {
+    double weight;
+};
+
+struct alignas(32) Wide {
+    float lanes[8];
+};
+
+struct Tag {};
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            return false;                                                                 \
+        }                                                                                 \
+    } while (0)
+
+// What an entity should hold
+struct Expected {
+    Entity entity;
+    int value;
+    bool weight = false;
+    bool wide = false;
+    bool tag = false;
+};
+
+bool matches(World& world, const Expected& expected) {
+    CHECK(world.isAlive(expected.entity));
+    Value* value = world.get<Value>(expected.entity);
+    CHECK(value && value->value == expected.value);
+    Weight* weight = world.get<Weight>(expected.entity);
+    CHECK((weight != nullptr) == expected.weight);
+    CHECK(!weight || weight->weight == expected.value * 0.5);
+    Wide* wide = world.get<Wide>(expected.entity);
+    CHECK((wide != nullptr) == expected.wide);
+    CHECK(!wide || (wide->lanes[7] == static_cast<float>(expected.value)
+                    && reinterpret_cast<uintptr_t>(wide) % alignof(Wide) == 0));
+    CHECK(world.has<Tag>(expected.entity) == expected.tag);
+    return true;
+}
+
+bool testRandomOperations() {
+    World world;
+    JobSystem jobs(3);
+    // Queries made before any of their archetypes exist must pick them up
+    View<const Value> values = world.query<const Value>();
+    View<const Value, const Weight> weighted = world.query<const Value, const Weight>();
+
+    std::mt19937 rng(7);
+    std::vector<Expected> live;
+    std::vector<Entity> destroyed;
+    int nextValue = 0;
+
+    for (int operation = 0; operation < 200000; ++operation) {
+        unsigned int choice = rng() % 8;
+        if (choice < 3 || live.empty()) {
+            Expected expected;
+            expected.value = nextValue++;
+            if (rng() % 2) {
+                expected.entity = world.create(Value{ expected.value });
+            } else {
+                expected.entity = world.create(Value{ expected.value }, Weight{ expected.value * 0.5 });
+                expected.weight = true;
+            }
+            live.push_back(expected);
+            continue;
+        }
+
+        size_t picked = rng() % live.size();
+        Expected& expected = live[picked];
+        switch (choice) {
+        case 3:
+            world.destroy(expected.entity);
+            destroyed.push_back(expected.entity);
+            live[picked] = live.back();
+            live.pop_back();
+            break;
+        case 4: {
+            Wide wide = {};
+            wide.lanes[7] = static_cast<float>(expected.value);
+            world.add(expected.entity, wide);
+            expected.wide = true;
+            break;
+        }
+        case 5:
+            world.remove<Weight>(expected.entity);
+            expected.weight = false;
+            break;
+        case 6:
+            world.add(expected.entity, Weight{ expected.value * 0.5 });
+            expected.weight = true;
+            break;
+        default:
+            if (expected.tag)
+                world.remove<Tag>(expected.entity);
+            else
+                world.add<Tag>(expected.entity);
+            expected.tag = !expected.tag;
+            break;
+        }
+    }
+
+    for (const Expected& expected : live)
+        CHECK(matches(world, expected));
+
+    // A destroyed handle stays dead even after its slot is reused
+    for (Entity entity : destroyed) {
+        CHECK(!world.isAlive(entity));
+        CHECK(world.get<Value>(entity) == nullptr);
+        world.destroy(entity);
+        world.add(entity, Tag());
+    }
+    for (const Expected& expected : live)
+        CHECK(matches(world, expected));
+
+    size_t weightCount = 0;
+    for (const Expected& expected : live)
+        weightCount += expected.weight ? 1 : 0;
+    CHECK(world.stats().entities == live.size());
+    CHECK(values.count() == live.size());
+    CHECK(weighted.count() == weightCount);
+
+    size_t visited = 0;
+    values.forEach([&visited](const Value&) { visited++; });
+    CHECK(visited == live.size());
+
+    // Parallel chunks cover [0, count) exactly once through their first index
+    std::vector<std::atomic<int>> rows(weighted.count());
+    for (std::atomic<int>& row : rows)
+        row = 0;
+    weighted.parallelForEachChunk(jobs, [&rows](size_t first, size_t count, const Value* value, const Weight* weight) {
+        for (size_t i = 0; i < count; ++i) {
+            if (weight[i].weight == value[i].value * 0.5)
+                rows[first + i].fetch_add(1);
+        }
+    });
+    for (std::atomic<int>& row : rows)
+        CHECK(row.load() == 1);
+    return true;
+}
+
+// Crossing a chunk boundary back and forth reuses the spare chunk
+bool testChunkBoundary() {
+    World world;
+    std::vector<Entity> entities;
+    entities.push_back(world.create(Value{ 0 }));
+    while (world.stats().chunks < 2)
+        entities.push_back(world.create(Value{ static_cast<int>(entities.size()) }));
+
+    // The first round allocates the component-less archetype's chunk
+    size_t allocated = 0;
+    for (int i = 0; i < 1000; ++i) {
+        world.destroy(entities.back());
+        entities.back() = world.create(Value{ i });
+        world.remove<Value>(entities.back());
+        world.add(entities.back(), Value{ i });
+        if (i == 0)
+            allocated = world.stats().chunksAllocated;
+    }
+    CHECK(world.stats().chunksAllocated == allocated);
+    CHECK(world.stats().chunks == 2);
+    return true;
+}
+
+}
+
+int main() {
+    struct {
+        const char* name;
+        bool (*run)();
+    } tests[] = {
+        { "random operations", testRandomOperations },
+        { "chunk boundary", testChunkBoundary },
+    };
+
+    int failures = 0;
+    for (const auto& test : tests) {
+        bool passed = test.run();
+        std::cout << (passed ? "PASS " : "FAIL ") << test.name << std::endl;
+        if (!passed)
+            failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+// Offline asset cooker: packs shaders, images and data files into the single
+// memory-mapped file read by AssetPack. See src/AssetPackFormat.h.
+//
+// Usage: asset_cooker <output.pak> [--compress <mode>] [--shaders <dir>] [--assets <dir>] ...
+//   --shaders  every file is GLSL source
+//   --assets   .ppm images become RGBA8 (pure magenta is transparent),
+//              anything else (level data, ...) is stored verbatim
+//   --compress how the images of later --assets directories are stored:
+//              none (RGBA8, the default), bc1, bc3, or auto (BC1 when the
+//              alpha is all 0 or 255, else BC3)
+// Assets are named by their path relative to the directory given.
+
+#include "AssetPackFormat.h"
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "Image.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace AssetPackFormat;
+
+namespace {
+
+struct Asset {
+    std::string name;
+    uint32_t type = ASSET_RAW;
+    uint32_t width = 0, height = 0;
+    uint32_t format = FORMAT_RGBA8;
+    std::vector<unsigned char> data;
+    uint64_t nameHash = 0;
+};
+
+bool readFile(const fs::path& path, std::vector<unsigned char>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+enum class Compression { None, BC1, BC3, Auto };
+
+bool parseCompression(const std::string& mode, Compression& compression) {
+    if (mode == "none") compression = Compression::None;
+    else if (mode == "bc1") compression = Compression::BC1;
+    else if (mode == "bc3") compression = Compression::BC3;
+    else if (mode == "auto") compression = Compression::Auto;
+    else return false;
+    return true;
+}
+
+// Encode an image's pixels in place. The encoders are a quick range fit;
+// the runtime decodes them back to RGBA8 when the GPU lacks S3TC.
+void compress(Asset& asset, Compression compression) {
+    if (compression == Compression::None)
+        return;
+    int width = static_cast<int>(asset.width), height = static_cast<int>(asset.height);
+    if (compression == Compression::Auto) {
+        bool binaryAlpha = true;
+        for (size_t i = 3; i < asset.data.size() && binaryAlpha; i += 4)
+            binaryAlpha = asset.data[i] == 0 || asset.data[i] == 255;
+        compression = binaryAlpha ? Compression::BC1 : Compression::BC3;
+    }
+
+    std::vector<unsigned char> blocks;
+    if (compression == Compression::BC1) {
+        blocks.resize(BlockCompression::bc1Size(width, height));
+        BlockCompression::encodeBC1(asset.data.data(), width, height, blocks.data());
+        asset.format = FORMAT_BC1;
+    } else {
+        blocks.resize(BlockCompression::bc3Size(width, height));
+        BlockCompression::encodeBC3(asset.data.data(), width, height, blocks.data());
+        asset.format = FORMAT_BC3;
+    }
+    asset.data.swap(blocks);
+}
+
+bool collect(const fs::path& root, bool shaders, Compression compression, std::vector<Asset>& assets) {
+    std::error_code error;
+    if (!fs::is_directory(root, error)) {
+        std::cerr << "asset_cooker: not a directory: " << root.string() << std::endl;
+        return false;
+    }
+
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file())
+            continue;
+
+        Asset asset;
+        asset.name = fs::relative(entry.path(), root).generic_string();
+        std::vector<unsigned char> file;
+        if (!readFile(entry.path(), file)) {
+            std::cerr << "asset_cooker: cannot read " << entry.path().string() << std::endl;
+            return false;
+        }
+
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (shaders) {
+            asset.type = ASSET_SHADER;
+            asset.data.swap(file);
+        } else if (extension == ".ppm") {
+            Image image;
+            if (!decodePPM(file.data(), file.size(), image)) {
+                std::cerr << "asset_cooker: unsupported PPM " << entry.path().string() << std::endl;
+                return false;
+            }
+            asset.type = ASSET_IMAGE;
+            asset.width = static_cast<uint32_t>(image.width);
+            asset.height = static_cast<uint32_t>(image.height);
+            asset.data.swap(image.pixels);
+            compress(asset, compression);
+        } else {
+            asset.type = ASSET_RAW;
+            asset.data.swap(file);
+        }
+        assets.push_back(std::move(asset));
+    }
+    return true;
+}
+
+void pad(std::ofstream& out, uint64_t& position) {
+    static const char zeros[ALIGNMENT] = {};
+    uint64_t aligned = (position + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    out.write(zeros, static_cast<std::streamsize>(aligned - position));
+    position = aligned;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: asset_cooker <output.pak> [--compress <mode>] [--shaders <dir>] [--assets <dir>] ..."
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<Asset> assets;
+    Compression compression = Compression::None;
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "asset_cooker: missing value for " << argv[i] << std::endl;
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--compress") == 0) {
+            if (!parseCompression(argv[i + 1], compression)) {
+                std::cerr << "asset_cooker: unknown compression " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        bool shaders = std::strcmp(argv[i], "--shaders") == 0;
+        if (!shaders && std::strcmp(argv[i], "--assets") != 0) {
+            std::cerr << "asset_cooker: unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        if (!collect(argv[i + 1], shaders, compression, assets))
+            return 1;
+    }
+
+    // Sorted table of contents; two names with one hash would make lookups ambiguous
+    for (Asset& asset : assets)
+        asset.nameHash = fnv1a64(asset.name.data(), asset.name.size());
+    std::sort(assets.begin(), assets.end(), [](const Asset& a, const Asset& b) { return a.nameHash < b.nameHash; });
+    for (size_t i = 1; i < assets.size(); ++i) {
+        if (assets[i].nameHash == assets[i - 1].nameHash) {
+            std::cerr << "asset_cooker: duplicate asset name (or hash) " << assets[i].name
+                      << " / " << assets[i - 1].name << std::endl;
+            return 1;
+        }
+    }
+
+    // Write next to the output and rename, so a running game never sees half a pack
+    std::string output = argv[1];
+    std::string temporary = output + ".tmp";
+    std::ofstream out(temporary, std::ios::binary);
+    if (!out) {
+        std::cerr << "asset_cooker: cannot write " << temporary << std::endl;
+        return 1;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(assets.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t position = sizeof(header);
+
+    std::vector<TocEntry> toc(assets.size());
+    std::string names;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        const Asset& asset = assets[i];
+        pad(out, position);
+
+        TocEntry& entry = toc[i];
+        entry.nameHash = asset.nameHash;
+        entry.offset = position;
+        entry.size = asset.data.size();
+        entry.contentHash = fnv1a64(asset.data.data(), asset.data.size());
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.type = asset.type;
+        entry.width = asset.width;
+        entry.height = asset.height;
+        entry.format = asset.format;
+        names += asset.name;
+        names += '\0';
+
+        out.write(reinterpret_cast<const char*>(asset.data.data()), static_cast<std::streamsize>(asset.data.size()));
+        position += asset.data.size();
+    }
+
+    pad(out, position);
+    header.tocOffset = position;
+    out.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(TocEntry)));
+    position += toc.size() * sizeof(TocEntry);
+    header.namesOffset = position;
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "asset_cooker: write failed " << temporary << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    fs::rename(temporary, output, error);
+    if (error) {
+        // Windows will not rename over an existing file
+        fs::remove(output, error);
+        fs::rename(temporary, output, error);
+    }
+    if (error) {
+        std::cerr << "asset_cooker: cannot replace " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << "Cooked " << assets.size() << " assets into " << output << std::endl;
+    return 0;
+}